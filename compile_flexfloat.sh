@@ -2,5 +2,5 @@ cd flexfloat
 rm -r build 2> /dev/null 
 mkdir build
 cd build
-cmake -DENABLE_STATS=ON .. 
+cmake -DENABLE_STATS=ON -DCMAKE_POSITION_INDEPENDENT_CODE=ON .. 
 make
@@ -0,0 +1,297 @@
+/* #############################################################################
+check_fixed: checks the fixed point kernel against a per-cell reference.
+
+The reference walks every diagonal one cell at a time, in the order of
+scrimp(), and computes each cell in 128 bits with the stage boundaries of
+scrimpff_run_fixed(): every value that enters a stage is rounded, saturated or
+wrapped, and counted if it does not fit. For several formats, in saturate and
+wrap mode and with both roundings, it compares the profile values, indices and
+overflow counters of both. With one thread, profile ties are resolved in the
+same order, so indices are compared too. With several threads only the values
+and the counters are compared.
+
+Usage:
+>> check_fixed timeseries.txt length window_size scale_factor
+
+Returns 0 when every run matches, 1 otherwise.
+############################################################################# */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "libscrimpff.h"
+
+typedef __int128 wide_t;
+
+/* Series, dot product, statistics and distance formats, for series scaled
+ * to [0.01, 1] like random_anomaly.txt with a 0.01 scale factor ------------ */
+static const char * format_names[] = {"shipped", "wide", "narrow",
+	"saturated"};
+
+static const scrimpff_q_t formats[][SCRIMPFF_FX_STAGES] = {
+	{{7, 8},  {21, 16}, {7, 24}, {20, 11}},  /* as the .qcfg files      */
+	{{1, 20}, {10, 30}, {5, 24}, {10, 20}},  /* no overflows            */
+	{{0, 8},  {4, 10},  {1, 12}, {5, 8}},    /* overflows in every stage */
+	{{1, 20}, {10, 30}, {3, 24}, {3, 28}}    /* 32 bit, saturated stage  */
+};
+
+static const char * stage_names[SCRIMPFF_FX_STAGES] = {"series", "dotp",
+	"stats", "dist"};
+
+/* Reference ---------------------------------------------------------------- */
+typedef struct
+{
+	scrimpff_fixed_t fx;
+	unsigned long long overflows[SCRIMPFF_FX_STAGES];
+} reference_t;
+
+static wide_t fit(reference_t * ref, int stage, scrimpff_q_t q, wide_t x)
+{
+	/* Saturates or wraps x to the signed 1 + m + n bit format q -------- */
+	int    bits = 1 + q.m + q.n;
+	wide_t lo   = -((wide_t) 1 << (bits - 1));
+	wide_t hi   =  ((wide_t) 1 << (bits - 1)) - 1;
+
+	if (x >= lo && x <= hi) return x;
+	ref->overflows[stage]++;
+	if (ref->fx.saturate) return x < lo ? lo : hi;
+
+	wide_t span = (wide_t) 1 << bits;
+	wide_t r    = (x - lo) % span;
+	return lo + (r < 0 ? r + span : r);
+}
+
+static wide_t drop(const reference_t * ref, wide_t x, int bits)
+{
+	/* Drops fractional bits, rounding to nearest or truncating --------- */
+	if (bits <= 0) return x;
+	if (ref->fx.nearest) x += (wide_t) 1 << (bits - 1);
+	return x >> bits;
+}
+
+static wide_t quantize(reference_t * ref, int stage, scrimpff_q_t q,
+		double x)
+{
+	double v = ldexp(x, q.n);
+	v = ref->fx.nearest ? floor(v + 0.5) : floor(v);
+	if (isnan(v)) v = 0;
+	if (v >  0x1p62) v =  0x1p62;
+	if (v < -0x1p62) v = -0x1p62;
+	return fit(ref, stage, q, (wide_t) v);
+}
+
+static void reference(const scrimpff_ctx_t * ctx, reference_t * ref,
+		double * profile, int * profileIdxs)
+{
+	const scrimpff_fixed_t * fx = &ref->fx;
+	int win           = ctx->windowSize;
+	int ProfileLength = ctx->ProfileLength;
+	int length        = ctx->timeSeriesLength;
+
+	wide_t * t     = malloc(sizeof(wide_t) * length);
+	wide_t * mean  = malloc(sizeof(wide_t) * ProfileLength);
+	wide_t * sigma = malloc(sizeof(wide_t) * ProfileLength);
+	wide_t * best  = malloc(sizeof(wide_t) * ProfileLength);
+	int    * seen  = calloc(ProfileLength, sizeof(int));
+
+	for (int s = 0; s < SCRIMPFF_FX_STAGES; s++) ref->overflows[s] = 0;
+	for (int i = 0; i < length; i++)
+		t[i] = quantize(ref, SCRIMPFF_FX_SERIES, fx->series,
+				ctx->tSeries[i]);
+	for (int i = 0; i < ProfileLength; i++)
+	{
+		mean[i]  = quantize(ref, SCRIMPFF_FX_STATS, fx->stats,
+				ctx->AMean[i]);
+		sigma[i] = quantize(ref, SCRIMPFF_FX_STATS, fx->stats,
+				1.0 / ctx->ASigma[i]);
+	}
+	wide_t windowSize = fit(ref, SCRIMPFF_FX_DIST, fx->dist,
+			(wide_t) win << fx->dist.n);
+
+	int shProd  = 2 * fx->series.n - fx->dotp.n;
+	int shLastz = fx->dotp.n - fx->dist.n;
+
+	for (int diag = ctx->exclusionZone + 1; diag < ProfileLength; diag++)
+	{
+		wide_t lastz = 0;
+		for (int w = 0; w < win; w++)
+			lastz = fit(ref, SCRIMPFF_FX_DOTP, fx->dotp, lastz
+				+ drop(ref, t[diag + w] * t[w], shProd));
+
+		for (int i = 0, j = diag; j < ProfileLength; i++, j++)
+		{
+			if (i > 0)
+				lastz = fit(ref, SCRIMPFF_FX_DOTP, fx->dotp, lastz
+					+ drop(ref, t[j + win - 1] * t[i + win - 1],
+						shProd)
+					- drop(ref, t[j - 1] * t[i - 1], shProd));
+
+			/* Distance of the cell, see fx_distances() -------- */
+			wide_t lastz_cast = fit(ref, SCRIMPFF_FX_DIST, fx->dist,
+					drop(ref, lastz, shLastz));
+			wide_t mean_prods = fit(ref, SCRIMPFF_FX_DIST, fx->dist,
+					drop(ref, mean[j] * mean[i],
+						2 * fx->stats.n - fx->dist.n));
+			wide_t sigma_prods = fit(ref, SCRIMPFF_FX_STATS,
+					fx->stats, drop(ref, sigma[j] * sigma[i],
+						fx->stats.n));
+			wide_t numerator = fit(ref, SCRIMPFF_FX_DIST, fx->dist,
+					lastz_cast - mean_prods * win);
+			wide_t corr = drop(ref, numerator * sigma_prods,
+					fx->stats.n);
+			wide_t distance = fit(ref, SCRIMPFF_FX_DIST, fx->dist,
+					2 * (windowSize - corr));
+			/* ------------------------------------------------- */
+
+			if (!seen[j] || distance < best[j])
+			{
+				best[j]        = distance;
+				profileIdxs[j] = i;
+				seen[j]        = 1;
+			}
+			if (!seen[i] || distance < best[i])
+			{
+				best[i]        = distance;
+				profileIdxs[i] = j;
+				seen[i]        = 1;
+			}
+		}
+	}
+
+	for (int i = 0; i < ProfileLength; i++)
+	{
+		profile[i] = seen[i] ? ldexp((double) best[i], -fx->dist.n)
+			: INFINITY;
+		if (!seen[i]) profileIdxs[i] = 0;
+	}
+
+	free(t);
+	free(mean);
+	free(sigma);
+	free(best);
+	free(seen);
+}
+/* -------------------------------------------------------------------------- */
+
+static scrimpff_ctx_t * load(const char * path, int length, int windowSize,
+		double scaleFactor, int numThreads)
+{
+	FILE * fp = fopen(path, "r");
+	if (fp == NULL)
+	{
+		printf("[ERROR] cannot open %s\n", path);
+		return NULL;
+	}
+
+	scrimpff_ctx_t * ctx = scrimpff_ctx_create(numThreads);
+	double * tSeries = ctx ? scrimpff_series(ctx, length, windowSize)
+		: NULL;
+	if (tSeries == NULL)
+	{
+		printf("[ERROR] cannot allocate a %d elements time series\n",
+				length);
+		fclose(fp);
+		return NULL;
+	}
+	for (int i = 0; i < length; i++)
+	{
+		if (fscanf(fp, "%lf", &tSeries[i]) != 1)
+		{
+			printf("[ERROR] %s has less than %d values\n", path,
+					length);
+			fclose(fp);
+			return NULL;
+		}
+		tSeries[i] *= scaleFactor;
+	}
+	fclose(fp);
+
+	if (scrimpff_preprocess(ctx))
+	{
+		printf("[ERROR] window size larger than the time series\n");
+		return NULL;
+	}
+	return ctx;
+}
+
+int main(int argc, char * argv[])
+{
+	if (argc != 5)
+	{
+		printf("[ERROR] usage: ./check_fixed timeseries.txt length"
+				" window_size scale_factor\n");
+		return 1;
+	}
+	int    length      = atoi(argv[2]);
+	int    windowSize  = atoi(argv[3]);
+	double scaleFactor = atof(argv[4]);
+
+	scrimpff_ctx_t * single = load(argv[1], length, windowSize, scaleFactor,
+			1);
+	scrimpff_ctx_t * multi  = load(argv[1], length, windowSize, scaleFactor,
+			4);
+	if (single == NULL || multi == NULL) return 1;
+
+	int      ProfileLength = single->ProfileLength;
+	double * profile       = malloc(sizeof(double) * ProfileLength);
+	int    * profileIdxs   = malloc(sizeof(int) * ProfileLength);
+
+	/* Every format, overflow mode and rounding ------------------------- */
+	int failed = 0;
+	int numFormats = sizeof(formats) / sizeof(formats[0]);
+	for (int f = 0; f < numFormats; f++)
+	for (int saturate = 1; saturate >= 0; saturate--)
+	for (int nearest = 1; nearest >= 0; nearest--)
+	{
+		reference_t ref;
+		ref.fx = (scrimpff_fixed_t) {formats[f][0], formats[f][1],
+			formats[f][2], formats[f][3], saturate, nearest};
+		reference(single, &ref, profile, profileIdxs);
+
+		scrimpff_ctx_t * runs[2] = {single, multi};
+		for (int r = 0; r < 2; r++)
+		{
+			scrimpff_ctx_t * ctx = runs[r];
+			if (scrimpff_run_fixed(ctx, &ref.fx))
+			{
+				printf("[ERROR] %s is not a valid format\n",
+						format_names[f]);
+				return 1;
+			}
+
+			int values = 0, indices = 0, counters = 0;
+			for (int i = 0; i < ProfileLength; i++)
+			{
+				if (ctx->profile_fixed[i] != profile[i])
+					values++;
+				if (ctx->numThreads == 1
+					&& ctx->profileIdxs_fixed[i]
+						!= profileIdxs[i])
+					indices++;
+			}
+			for (int s = 0; s < SCRIMPFF_FX_STAGES; s++)
+				counters += ctx->fixedOverflows[s]
+					!= ref.overflows[s];
+
+			printf("[%s] %-9s %s %s %d thread%s: %d/%d values, "
+				"%d indices and %d counters differ\n",
+				(values || indices || counters) ? "FAIL" : "PASS",
+				format_names[f], saturate ? "saturate" : "wrap    ",
+				nearest ? "nearest " : "truncate", ctx->numThreads,
+				ctx->numThreads > 1 ? "s" : " ", values,
+				ProfileLength, indices, counters);
+			for (int s = 0; counters && s < SCRIMPFF_FX_STAGES; s++)
+				printf("       %-6s %llu, reference %llu\n",
+					stage_names[s], ctx->fixedOverflows[s],
+					ref.overflows[s]);
+			failed |= values || indices || counters;
+		}
+	}
+	/* ------------------------------------------------------------------ */
+
+	free(profile);
+	free(profileIdxs);
+	scrimpff_ctx_destroy(single);
+	scrimpff_ctx_destroy(multi);
+	return failed;
+}
@@ -0,0 +1,104 @@
+/* #############################################################################
+check_native: checks that the native kernels reproduce FlexFloat exactly.
+
+For every native format, runs scrimpff_run_ff() with the equivalent FlexFloat
+formats and scrimpff_run_native() on the same series and compares both
+profiles value by value and index by index. It runs with one thread, so
+profile ties are resolved in the same order by both kernels.
+
+Usage:
+>> check_native timeseries.txt length window_size scale_factor
+
+Returns 0 when every format matches, 1 otherwise.
+############################################################################# */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "libscrimpff.h"
+
+static const char * native_names[] = {"", "float32", "float16", "bfloat16"};
+
+static const scrimpff_prec_t native_precs[] = {
+	{{0, 0},  {0, 0},  {0, 0},  {0, 0}},
+	{{8, 23}, {8, 23}, {8, 23}, {8, 23}},
+	{{5, 10}, {5, 10}, {5, 10}, {5, 10}},
+	{{8, 7},  {8, 7},  {8, 7},  {8, 7}}
+};
+
+int main(int argc, char * argv[])
+{
+	if (argc != 5)
+	{
+		printf("[ERROR] usage: ./check_native timeseries.txt length"
+				" window_size scale_factor\n");
+		return 1;
+	}
+	int    length      = atoi(argv[2]);
+	int    windowSize  = atoi(argv[3]);
+	double scaleFactor = atof(argv[4]);
+
+	/* Time series loading ---------------------------------------------- */
+	FILE * fp = fopen(argv[1], "r");
+	if (fp == NULL)
+	{
+		printf("[ERROR] cannot open %s\n", argv[1]);
+		return 1;
+	}
+
+	scrimpff_ctx_t * ctx = scrimpff_ctx_create(1);
+	double * tSeries = ctx ? scrimpff_series(ctx, length, windowSize)
+		: NULL;
+	if (tSeries == NULL)
+	{
+		printf("[ERROR] cannot allocate a %d elements time series\n",
+				length);
+		return 1;
+	}
+	for (int i = 0; i < length; i++)
+	{
+		if (fscanf(fp, "%lf", &tSeries[i]) != 1)
+		{
+			printf("[ERROR] %s has less than %d values\n", argv[1],
+					length);
+			return 1;
+		}
+		tSeries[i] *= scaleFactor;
+	}
+	fclose(fp);
+
+	if (scrimpff_preprocess(ctx))
+	{
+		printf("[ERROR] window size larger than the time series\n");
+		return 1;
+	}
+	/* ------------------------------------------------------------------ */
+
+	/* Comparing every native format with FlexFloat --------------------- */
+	int failed = 0;
+	for (int f = SCRIMPFF_NATIVE_F32; f <= SCRIMPFF_NATIVE_BF16; f++)
+	{
+		scrimpff_run_ff(ctx, &native_precs[f]);
+		scrimpff_run_native(ctx, (scrimpff_native_t) f);
+
+		int values = 0, indices = 0;
+		for (int i = 0; i < ctx->ProfileLength; i++)
+		{
+			double d_ff = ff_get_double(&ctx->profile_ff[i]);
+			double d_nat = ctx->profile_native[i];
+			if (d_ff != d_nat && !(d_ff != d_ff && d_nat != d_nat))
+				values++;
+			if (ctx->profileIdxs_ff[i] != ctx->profileIdxs_native[i])
+				indices++;
+		}
+
+		printf("[%s] %-8s %d/%d values and %d indices differ\n",
+				(values || indices) ? "FAIL" : "PASS",
+				native_names[f], values, ctx->ProfileLength,
+				indices);
+		failed |= values || indices;
+	}
+	/* ------------------------------------------------------------------ */
+
+	scrimpff_ctx_destroy(ctx);
+	return failed;
+}
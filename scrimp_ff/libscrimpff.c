@@ -0,0 +1,1411 @@
+/* #############################################################################
+libscrimpff: SCRIMP and SCRIMP FlexFloat matrix profile kernels as a library.
+
+See libscrimpff.h for the context lifecycle. The arena layout is computed by
+arena_layout(), which is used both to size the arena and to point every buffer
+of the context into it, so adding a buffer only requires one ARENA_SLOT line.
+
+Every phase of a job is timed with the monotonic clock into ctx->metrics. The
+kernels also record, for each thread, the time spent on its diagonals and on
+the final reduction, measured before the barrier so waiting is not included.
+############################################################################# */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+#include "libscrimpff.h"
+
+#define ARENA_ALIGN   64
+#define MIN_CAPACITY  1024
+#define MAX_CAPACITY  (1 << 30)
+#define FX_BLOCK      256
+#define FX_LANES      8
+#define NATIVE_BLOCK  256
+#define NATIVE_LANES  8
+#define SCRATCH_LANES (NATIVE_LANES > FX_LANES ? NATIVE_LANES : FX_LANES)
+
+/* Private profiles and scratch of a context (views into the arena) -------- */
+struct scrimpff_scratch
+{
+	void        * arena;
+	double      * tSeriesBuffer;
+	double      * ACumSum;
+	double      * ASqCumSum;
+	int         * idx;
+	flexfloat_t * tSeries_ff;
+	flexfloat_t * AMean_ff;
+	flexfloat_t * ASigma_ff;
+	double      * profile_priv;
+	flexfloat_t * profile_priv_ff;
+	int         * profileIdxs_priv;
+
+	/* Shared by the native and fixed point kernels, which never run at
+	 * the same time. They hold float, 16 bit or int32_t values -------- */
+	uint32_t    * tSeries32;
+	uint32_t    * AMean32;
+	uint32_t    * ASigma32;      /* 1/sigma in fixed point       */
+	uint32_t    * profile_priv32;
+	uint32_t    * lastzs32;
+};
+
+static size_t arena_align(size_t bytes)
+{
+	return (bytes + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+static size_t arena_layout(scrimpff_ctx_t * ctx, char * arena, int capacity)
+{
+	/* Places every buffer in the arena, or only sizes it if arena is NULL */
+	size_t series  = (size_t) capacity;
+	size_t priv    = (size_t) capacity * ctx->numThreads;
+	size_t offset  = 0;
+	scrimpff_scratch_t * s = ctx->scratch;
+
+	#define ARENA_SLOT(view, type, count)                                  \
+		if (arena) view = (type *) (arena + offset);                   \
+		offset += arena_align(sizeof(type) * (count));
+
+	ARENA_SLOT(s->tSeriesBuffer,      double,      series);
+	ARENA_SLOT(ctx->AMean,            double,      series);
+	ARENA_SLOT(ctx->ASigma,           double,      series);
+	ARENA_SLOT(ctx->profile,          double,      series);
+	ARENA_SLOT(s->ACumSum,            double,      series);
+	ARENA_SLOT(s->ASqCumSum,          double,      series);
+	ARENA_SLOT(ctx->profileIdxs,      int,         series);
+	ARENA_SLOT(ctx->profileIdxs_ff,   int,         series);
+	ARENA_SLOT(s->idx,                int,         series);
+	ARENA_SLOT(s->tSeries_ff,         flexfloat_t, series);
+	ARENA_SLOT(s->AMean_ff,           flexfloat_t, series);
+	ARENA_SLOT(s->ASigma_ff,          flexfloat_t, series);
+	ARENA_SLOT(ctx->profile_ff,       flexfloat_t, series);
+	ARENA_SLOT(ctx->profile_native,   double,      series);
+	ARENA_SLOT(ctx->profileIdxs_native, int,       series);
+	ARENA_SLOT(ctx->profile_fixed,    double,      series);
+	ARENA_SLOT(ctx->profileIdxs_fixed, int,        series);
+	ARENA_SLOT(s->profile_priv,       double,      priv);
+	ARENA_SLOT(s->profile_priv_ff,    flexfloat_t, priv);
+	ARENA_SLOT(s->profileIdxs_priv,   int,         priv);
+	ARENA_SLOT(s->tSeries32,          uint32_t,    series);
+	ARENA_SLOT(s->AMean32,            uint32_t,    series);
+	ARENA_SLOT(s->ASigma32,           uint32_t,    series);
+	ARENA_SLOT(s->profile_priv32,     uint32_t,    priv);
+	ARENA_SLOT(s->lastzs32,           uint32_t,    priv * SCRATCH_LANES);
+
+	#undef ARENA_SLOT
+
+	return offset;
+}
+
+scrimpff_ctx_t * scrimpff_ctx_create(int numThreads)
+{
+	if (numThreads < 1) return NULL;
+
+	scrimpff_ctx_t * ctx = calloc(1, sizeof(scrimpff_ctx_t));
+	if (ctx == NULL) return NULL;
+	ctx->scratch = calloc(1, sizeof(scrimpff_scratch_t));
+	if (ctx->scratch == NULL)
+	{
+		free(ctx);
+		return NULL;
+	}
+
+	/* Per-thread metrics, one row of numThreads per kernel ------------- */
+	size_t count = (size_t) SCRIMPFF_KERNELS * numThreads;
+	uint64_t * thread = calloc(3 * count, sizeof(uint64_t));
+	if (thread == NULL)
+	{
+		free(ctx->scratch);
+		free(ctx);
+		return NULL;
+	}
+	ctx->metrics.threadDiagNs    = thread;
+	ctx->metrics.threadReduceNs  = thread + count;
+	ctx->metrics.threadDiagonals = thread + 2 * count;
+	/* ------------------------------------------------------------------ */
+
+	ctx->numThreads = numThreads;
+	return ctx;
+}
+
+void scrimpff_ctx_destroy(scrimpff_ctx_t * ctx)
+{
+	if (ctx == NULL) return;
+	free(ctx->metrics.threadDiagNs);
+	free(ctx->scratch->arena);
+	free(ctx->scratch);
+	free(ctx);
+}
+
+/* Kernels, defined at the end of the file and private to the library ------ */
+/* Per-thread timings of one kernel, NULL pointers disable them */
+typedef struct
+{
+	uint64_t * diagNs;       /* diagonal processing, without waiting     */
+	uint64_t * reduceNs;     /* final profile reduction                  */
+	uint64_t * diagonals;    /* diagonals processed                      */
+} scrimpff_thread_metrics_t;
+
+static void scrimp(double * tSeries,  double * AMean, double * ASigma,
+		int timeSeriesLength, int ProfileLength,
+		int windowSize, int* idx, double * profile, int * profileIndex,
+		int exclusionZone, int numThreads,
+		double * profile_tmp, int * profileIndex_tmp,
+		scrimpff_thread_metrics_t tm);
+
+static void scrimp_ff(flexfloat_t * tSeries, flexfloat_t* AMean,
+		flexfloat_t* ASigma, int timeSeriesLength, int ProfileLength,
+		flexfloat_t windowSize, int* idx, flexfloat_t * profile,
+		int* profileIdxs, int exclusionZone, int numThreads,
+		const scrimpff_prec_t * prec, flexfloat_t * profile_priv,
+		int * profileIdxs_priv, scrimpff_thread_metrics_t tm);
+
+/* Metrics ------------------------------------------------------------------ */
+static const char * phase_names[SCRIMPFF_PHASES] = {"alloc", "count_lines",
+	"load", "preprocess", "ff_convert", "ff_kernel", "kernel", "native",
+	"fixed", "scan", "write"};
+
+static const char * kernel_names[SCRIMPFF_KERNELS] = {"double", "flexfloat",
+	"native", "fixed"};
+
+static const scrimpff_phase_t kernel_phases[SCRIMPFF_KERNELS] = {
+	SCRIMPFF_PHASE_KERNEL, SCRIMPFF_PHASE_FF_KERNEL, SCRIMPFF_PHASE_NATIVE,
+	SCRIMPFF_PHASE_FIXED};
+
+uint64_t scrimpff_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+void scrimpff_phase_begin(scrimpff_ctx_t * ctx, scrimpff_phase_t phase)
+{
+	ctx->metrics.phaseStart[phase] = scrimpff_now_ns();
+}
+
+uint64_t scrimpff_phase_end(scrimpff_ctx_t * ctx, scrimpff_phase_t phase)
+{
+	uint64_t ns = scrimpff_now_ns() - ctx->metrics.phaseStart[phase];
+	ctx->metrics.phaseNs[phase]    += ns;
+	ctx->metrics.phaseLastNs[phase] = ns;
+	ctx->metrics.phaseCalls[phase]++;
+	return ns;
+}
+
+void scrimpff_metrics_reset(scrimpff_ctx_t * ctx)
+{
+	scrimpff_metrics_t * m = &ctx->metrics;
+	size_t count = (size_t) SCRIMPFF_KERNELS * ctx->numThreads;
+
+	memset(m->threadDiagNs, 0, 3 * count * sizeof(uint64_t));
+	memset(m->phaseNs,     0, sizeof(m->phaseNs));
+	memset(m->phaseLastNs, 0, sizeof(m->phaseLastNs));
+	memset(m->phaseCalls,  0, sizeof(m->phaseCalls));
+	m->cells        = 0;
+	m->diagonals    = 0;
+	m->bytesRead    = 0;
+	m->bytesWritten = 0;
+}
+
+static scrimpff_thread_metrics_t thread_metrics(scrimpff_ctx_t * ctx,
+		scrimpff_kernel_t kernel)
+{
+	size_t row = (size_t) kernel * ctx->numThreads;
+	return (scrimpff_thread_metrics_t) {ctx->metrics.threadDiagNs + row,
+		ctx->metrics.threadReduceNs + row,
+		ctx->metrics.threadDiagonals + row};
+}
+
+static void count_cells(scrimpff_ctx_t * ctx)
+{
+	/* Diagonal d has ProfileLength - d cells, d > exclusionZone -------- */
+	int64_t diagonals = ctx->ProfileLength - (ctx->exclusionZone + 1);
+	if (diagonals < 0) diagonals = 0;
+	ctx->metrics.diagonals += diagonals;
+	ctx->metrics.cells     += diagonals * (diagonals + 1) / 2;
+}
+
+static void write_threads(FILE * out, const uint64_t * values, int count)
+{
+	for (int t = 0; t < count; t++)
+		fprintf(out, t ? ", %llu" : "%llu",
+				(unsigned long long) values[t]);
+}
+
+static int write_json(const scrimpff_ctx_t * ctx, FILE * out)
+{
+	const scrimpff_metrics_t * m = &ctx->metrics;
+	int numThreads = ctx->numThreads;
+
+	fprintf(out, "{\n  \"threads\": %d,\n", numThreads);
+	fprintf(out, "  \"series_length\": %d,\n", ctx->timeSeriesLength);
+	fprintf(out, "  \"window_size\": %d,\n", ctx->windowSize);
+	fprintf(out, "  \"profile_length\": %d,\n", ctx->ProfileLength);
+
+	fprintf(out, "  \"phases\": {\n");
+	for (int p = 0; p < SCRIMPFF_PHASES; p++)
+		fprintf(out, "    \"%s\": {\"total_ns\": %llu, \"last_ns\": "
+			"%llu, \"calls\": %llu}%s\n", phase_names[p],
+			(unsigned long long) m->phaseNs[p],
+			(unsigned long long) m->phaseLastNs[p],
+			(unsigned long long) m->phaseCalls[p],
+			p + 1 < SCRIMPFF_PHASES ? "," : "");
+	fprintf(out, "  },\n");
+
+	fprintf(out, "  \"counters\": {\"cells\": %llu, \"diagonals\": %llu, "
+		"\"bytes_read\": %llu, \"bytes_written\": %llu},\n",
+		(unsigned long long) m->cells,
+		(unsigned long long) m->diagonals,
+		(unsigned long long) m->bytesRead,
+		(unsigned long long) m->bytesWritten);
+
+	/* Per-thread timings of the last run of each kernel ---------------- */
+	fprintf(out, "  \"kernels\": {");
+	int first = 1;
+	for (int k = 0; k < SCRIMPFF_KERNELS; k++)
+	{
+		if (m->phaseCalls[kernel_phases[k]] == 0) continue;
+		size_t row = (size_t) k * numThreads;
+		fprintf(out, "%s\n    \"%s\": {\n      \"diagonal_ns\": [",
+				first ? "" : ",", kernel_names[k]);
+		write_threads(out, m->threadDiagNs + row, numThreads);
+		fprintf(out, "],\n      \"reduction_ns\": [");
+		write_threads(out, m->threadReduceNs + row, numThreads);
+		fprintf(out, "],\n      \"diagonals\": [");
+		write_threads(out, m->threadDiagonals + row, numThreads);
+		fprintf(out, "]\n    }");
+		first = 0;
+	}
+	fprintf(out, "%s}\n}\n", first ? "" : "\n  ");
+	/* ------------------------------------------------------------------ */
+
+	return ferror(out) ? -1 : 0;
+}
+
+static void write_prom_threads(FILE * out, const scrimpff_ctx_t * ctx,
+		const char * name, const char * help, const uint64_t * values,
+		double scale)
+{
+	/* One sample per thread of every kernel that has run -------------- */
+	int numThreads = ctx->numThreads;
+
+	fprintf(out, "# HELP %s %s\n# TYPE %s gauge\n", name, help, name);
+	for (int k = 0; k < SCRIMPFF_KERNELS; k++)
+	{
+		if (ctx->metrics.phaseCalls[kernel_phases[k]] == 0) continue;
+		for (int t = 0; t < numThreads; t++)
+			fprintf(out, "%s{kernel=\"%s\",thread=\"%d\"} %.9g\n",
+				name, kernel_names[k], t,
+				values[(size_t) k * numThreads + t] * scale);
+	}
+}
+
+static int write_prometheus(const scrimpff_ctx_t * ctx, FILE * out)
+{
+	const scrimpff_metrics_t * m = &ctx->metrics;
+
+	fprintf(out, "# HELP scrimpff_phase_seconds_total Time spent in each "
+		"phase.\n# TYPE scrimpff_phase_seconds_total counter\n");
+	for (int p = 0; p < SCRIMPFF_PHASES; p++)
+		fprintf(out, "scrimpff_phase_seconds_total{phase=\"%s\"} %.9f\n",
+			phase_names[p], m->phaseNs[p] * 1e-9);
+
+	fprintf(out, "# HELP scrimpff_phase_last_seconds Time of the last "
+		"call of each phase.\n# TYPE scrimpff_phase_last_seconds "
+		"gauge\n");
+	for (int p = 0; p < SCRIMPFF_PHASES; p++)
+		fprintf(out, "scrimpff_phase_last_seconds{phase=\"%s\"} %.9f\n",
+			phase_names[p], m->phaseLastNs[p] * 1e-9);
+
+	fprintf(out, "# HELP scrimpff_phase_calls_total Calls of each phase."
+		"\n# TYPE scrimpff_phase_calls_total counter\n");
+	for (int p = 0; p < SCRIMPFF_PHASES; p++)
+		fprintf(out, "scrimpff_phase_calls_total{phase=\"%s\"} %llu\n",
+			phase_names[p], (unsigned long long) m->phaseCalls[p]);
+
+	const char * names[4] = {"cells", "diagonals", "bytes_read",
+		"bytes_written"};
+	const char * helps[4] = {"Distance matrix cells computed.",
+		"Diagonals processed.", "Input bytes read.",
+		"Output bytes written."};
+	const uint64_t values[4] = {m->cells, m->diagonals, m->bytesRead,
+		m->bytesWritten};
+	for (int c = 0; c < 4; c++)
+		fprintf(out, "# HELP scrimpff_%s_total %s\n# TYPE scrimpff_%s_total "
+			"counter\nscrimpff_%s_total %llu\n", names[c], helps[c],
+			names[c], names[c], (unsigned long long) values[c]);
+
+	/* Per-thread timings of the last run of each kernel ---------------- */
+	write_prom_threads(out, ctx, "scrimpff_thread_diagonal_seconds",
+		"Time a thread spent on its diagonals.", m->threadDiagNs, 1e-9);
+	write_prom_threads(out, ctx, "scrimpff_thread_reduction_seconds",
+		"Time a thread spent on the profile reduction.",
+		m->threadReduceNs, 1e-9);
+	write_prom_threads(out, ctx, "scrimpff_thread_diagonals",
+		"Diagonals processed by a thread.", m->threadDiagonals, 1);
+	/* ------------------------------------------------------------------ */
+
+	return ferror(out) ? -1 : 0;
+}
+
+int scrimpff_metrics_write(const scrimpff_ctx_t * ctx, FILE * out,
+		scrimpff_metrics_format_t format)
+{
+	switch (format)
+	{
+		case SCRIMPFF_METRICS_JSON:
+			return write_json(ctx, out);
+		case SCRIMPFF_METRICS_PROMETHEUS:
+			return write_prometheus(ctx, out);
+		default:
+			return -1;
+	}
+}
+/* -------------------------------------------------------------------------- */
+
+double * scrimpff_series(scrimpff_ctx_t * ctx, int timeSeriesLength,
+		int windowSize)
+{
+	if (timeSeriesLength <= 0 || timeSeriesLength > MAX_CAPACITY
+			|| windowSize <= 0)
+		return NULL;
+
+	/* Growing the arena to the next size class ------------------------- */
+	if (timeSeriesLength > ctx->capacity)
+	{
+		int capacity = MIN_CAPACITY;
+		while (capacity < timeSeriesLength) capacity *= 2;
+
+		scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_ALLOC);
+		size_t bytes = arena_layout(ctx, NULL, capacity);
+		void * arena = aligned_alloc(ARENA_ALIGN, bytes);
+		scrimpff_phase_end(ctx, SCRIMPFF_PHASE_ALLOC);
+		if (arena == NULL) return NULL;
+
+		free(ctx->scratch->arena);
+		ctx->scratch->arena = arena;
+		ctx->arenaBytes = bytes;
+		ctx->capacity   = capacity;
+		arena_layout(ctx, arena, capacity);
+	}
+	/* ------------------------------------------------------------------ */
+
+	ctx->timeSeriesLength = timeSeriesLength;
+	ctx->windowSize       = windowSize;
+	ctx->ProfileLength    = timeSeriesLength - windowSize + 1;
+	ctx->exclusionZone    = windowSize / EXCLUSION_FACTOR;
+	ctx->tSeries          = ctx->scratch->tSeriesBuffer;
+
+	return ctx->tSeries;
+}
+
+int scrimpff_set_series(scrimpff_ctx_t * ctx, double * tSeries,
+		int timeSeriesLength, int windowSize)
+{
+	if (tSeries == NULL
+		|| scrimpff_series(ctx, timeSeriesLength, windowSize) == NULL)
+		return -1;
+
+	ctx->tSeries = tSeries;
+	return 0;
+}
+
+int scrimpff_preprocess(scrimpff_ctx_t * ctx)
+{
+	int      timeSeriesLength = ctx->timeSeriesLength;
+	int      windowSize       = ctx->windowSize;
+	int      ProfileLength    = ctx->ProfileLength;
+	int      exclusionZone    = ctx->exclusionZone;
+	double * tSeries          = ctx->tSeries;
+	double * ACumSum          = ctx->scratch->ACumSum;
+	double * ASqCumSum        = ctx->scratch->ASqCumSum;
+
+	if (ctx->scratch->arena == NULL || windowSize > timeSeriesLength) return -1;
+
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_PREPROCESS);
+
+	/* Time series range ------------------------------------------------ */
+	ctx->tSeriesMin = INFINITY;
+	ctx->tSeriesMax = 0;
+	for (int i = 0; i < timeSeriesLength; i++)
+	{
+		if (tSeries[i] < ctx->tSeriesMin) ctx->tSeriesMin = tSeries[i];
+		if (tSeries[i] > ctx->tSeriesMax) ctx->tSeriesMax = tSeries[i];
+	}
+	/* ------------------------------------------------------------------ */
+
+	/* Mean and standard deviation -------------------------------------- */
+	ACumSum[0] = tSeries[0];
+	for (int i = 1; i < timeSeriesLength; i++)
+		ACumSum[i] = tSeries[i] + ACumSum[i - 1];
+	ASqCumSum[0] = tSeries[0] * tSeries[0];
+	for (int i = 1; i < timeSeriesLength; i++)
+		ASqCumSum[i] = tSeries[i] * tSeries[i] + ASqCumSum[i - 1];
+	for (int i = 0; i < ProfileLength; i++)
+	{
+		double ASum   = (i == 0) ? ACumSum[windowSize - 1]
+			: ACumSum[windowSize + i - 1] - ACumSum[i - 1];
+		double ASumSq = (i == 0) ? ASqCumSum[windowSize - 1]
+			: ASqCumSum[windowSize + i - 1] - ASqCumSum[i - 1];
+		ctx->AMean[i]  = ASum / windowSize;
+		ctx->ASigma[i] = sqrt(ASumSq / windowSize
+				- ctx->AMean[i] * ctx->AMean[i]);
+	}
+	/* ------------------------------------------------------------------ */
+
+	/* Initializing diagonals and profile ------------------------------- */
+	for (int i = exclusionZone + 1; i < ProfileLength; i++)
+		ctx->scratch->idx[i - (exclusionZone + 1)] = i;
+
+	for (int i = 0; i < ProfileLength; i++)
+	{
+		ctx->profile[i]     = INFINITY;
+		ctx->profileIdxs[i] = 0;
+	}
+	/* ------------------------------------------------------------------ */
+
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_PREPROCESS);
+	return 0;
+}
+
+void scrimpff_run(scrimpff_ctx_t * ctx)
+{
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_KERNEL);
+	scrimp(ctx->tSeries, ctx->AMean, ctx->ASigma, ctx->timeSeriesLength,
+			ctx->ProfileLength, ctx->windowSize, ctx->scratch->idx,
+			ctx->profile, ctx->profileIdxs, ctx->exclusionZone,
+			ctx->numThreads, ctx->scratch->profile_priv,
+			ctx->scratch->profileIdxs_priv,
+			thread_metrics(ctx, SCRIMPFF_KERNEL_DOUBLE));
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_KERNEL);
+	count_cells(ctx);
+}
+
+void scrimpff_run_ff(scrimpff_ctx_t * ctx, const scrimpff_prec_t * prec)
+{
+	scrimpff_scratch_t * s = ctx->scratch;
+
+	/* Converting inputs to FlexFloat ----------------------------------- */
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_FF_CONVERT);
+	for (int i = 0; i < ctx->timeSeriesLength; i++)
+		ff_init_double(&s->tSeries_ff[i], ctx->tSeries[i], prec->dotp);
+
+	for (int i = 0; i < ctx->ProfileLength; i++)
+	{
+		ff_init_double(&s->AMean_ff[i],   ctx->AMean[i],  prec->stats);
+		ff_init_double(&s->ASigma_ff[i],  ctx->ASigma[i], prec->stats);
+		ff_init_double(&ctx->profile_ff[i], INFINITY,       prec->prof);
+	}
+
+	flexfloat_t windowSize_ff;
+	ff_init_double(&windowSize_ff, ctx->windowSize, prec->dist);
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_FF_CONVERT);
+	/* ------------------------------------------------------------------ */
+
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_FF_KERNEL);
+	scrimp_ff(s->tSeries_ff, s->AMean_ff, s->ASigma_ff,
+			ctx->timeSeriesLength, ctx->ProfileLength, windowSize_ff,
+			s->idx, ctx->profile_ff, ctx->profileIdxs_ff,
+			ctx->exclusionZone, ctx->numThreads, prec,
+			s->profile_priv_ff, s->profileIdxs_priv,
+			thread_metrics(ctx, SCRIMPFF_KERNEL_FF));
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_FF_KERNEL);
+	count_cells(ctx);
+}
+
+static inline float f32_round_odd(double d)
+{
+	/* double -> float rounding to odd. Rounding the result again to a
+	 * format with at most 22 significand bits gives the same value as
+	 * rounding d directly, for d in the float normal range ------------- */
+	uint64_t u;
+	memcpy(&u, &d, sizeof(u));
+	uint64_t sticky = (u & 0x1FFFFFFF) != 0;
+	u = (u & ~(uint64_t) 0x1FFFFFFF) | (sticky << 29);
+	memcpy(&d, &u, sizeof(d));
+	return (float) d;
+}
+
+static inline uint32_t f16_store(float f)
+{
+	/* float -> binary16, round to nearest even, branch-free. The bits are
+	 * returned in 32 bits so a rounding stays at the float vector width */
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	uint32_t sign = (u >> 16) & 0x8000;
+	u &= 0x7FFFFFFF;
+
+	/* Subnormal results: the float addition rounds at the right bit */
+	float a;
+	memcpy(&a, &u, sizeof(a));
+	a += 0.5f;
+	uint32_t subnormal;
+	memcpy(&subnormal, &a, sizeof(subnormal));
+	subnormal -= 0x3F000000;
+
+	uint32_t normal = (u + 0xC8000FFF + ((u >> 13) & 1)) >> 13;
+	uint32_t h = u < 0x38800000 ? subnormal : normal;
+	h = u >= 0x47800000 ? 0x7C00 : h;     /* overflow to infinity  */
+	h = u >  0x7F800000 ? 0x7E00 : h;     /* quiet NaN             */
+	return h | sign;
+}
+
+static inline float f16_load(uint32_t h)
+{
+	/* binary16 -> float, exact, branch-free ---------------------------- */
+	uint32_t u   = (uint32_t) (h & 0x7FFF) << 13;
+	uint32_t exp = u & 0x0F800000;
+	float subnormal;
+	uint32_t s = u + 0x38800000;
+	memcpy(&subnormal, &s, sizeof(subnormal));
+	subnormal -= 0x1p-14f;
+	uint32_t sub;
+	memcpy(&sub, &subnormal, sizeof(sub));
+
+	u += 0x38000000;
+	u  = exp == 0x0F800000 ? u + 0x38000000 : u;   /* inf and NaN */
+	u  = exp == 0 ? sub : u;                        /* subnormals  */
+	u |= (uint32_t) (h & 0x8000) << 16;
+
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+static inline uint16_t bf16_store(float f)
+{
+	/* float -> bfloat16, round to nearest even, branch-free ------------ */
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	uint32_t rounded = (u + 0x7FFF + ((u >> 16) & 1)) >> 16;
+	uint32_t quiet   = (u >> 16) | 0x40;
+	return (uint16_t) (f != f ? quiet : rounded);
+}
+
+static inline float bf16_load(uint16_t h)
+{
+	uint32_t u = (uint32_t) h << 16;
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+/* Native kernels ----------------------------------------------------------- */
+#define NATIVE_NAME           scrimp_f32
+#define NATIVE_STORAGE_T      float
+#define NATIVE_COMPUTE_T      float
+#define NATIVE_LOAD(x)        (x)
+#define NATIVE_STORE(x)       (x)
+#define NATIVE_STORE_WIDE(x)  ((float) (x))
+#define NATIVE_FMA            fma
+#include "scrimp_native.h"
+
+#define NATIVE_NAME           scrimp_f16
+#define NATIVE_STORAGE_T      uint16_t
+#define NATIVE_COMPUTE_T      float
+#define NATIVE_LOAD(x)        f16_load(x)
+#define NATIVE_STORE(x)       f16_store(x)
+#define NATIVE_STORE_WIDE(x)  f16_store(f32_round_odd(x))
+#define NATIVE_FMA            fma
+#include "scrimp_native.h"
+
+#define NATIVE_NAME           scrimp_bf16
+#define NATIVE_STORAGE_T      uint16_t
+#define NATIVE_COMPUTE_T      float
+#define NATIVE_LOAD(x)        bf16_load(x)
+#define NATIVE_STORE(x)       bf16_store(x)
+#define NATIVE_STORE_WIDE(x)  bf16_store(f32_round_odd(x))
+#define NATIVE_FMA            fma
+#include "scrimp_native.h"
+/* -------------------------------------------------------------------------- */
+
+scrimpff_native_t scrimpff_native_format(const scrimpff_prec_t * prec)
+{
+	const flexfloat_desc_t * stages[3] = {&prec->dotp, &prec->stats,
+		&prec->prof};
+
+	for (int i = 0; i < 3; i++)
+		if (stages[i]->exp_bits  != prec->dist.exp_bits
+			|| stages[i]->frac_bits != prec->dist.frac_bits)
+			return SCRIMPFF_NATIVE_NONE;
+
+	if (prec->dist.exp_bits == 8 && prec->dist.frac_bits == 23)
+		return SCRIMPFF_NATIVE_F32;
+	if (prec->dist.exp_bits == 5 && prec->dist.frac_bits == 10)
+		return SCRIMPFF_NATIVE_F16;
+	if (prec->dist.exp_bits == 8 && prec->dist.frac_bits == 7)
+		return SCRIMPFF_NATIVE_BF16;
+	return SCRIMPFF_NATIVE_NONE;
+}
+
+int scrimpff_run_native(scrimpff_ctx_t * ctx, scrimpff_native_t format)
+{
+	void (* kernel)(scrimpff_ctx_t *, scrimpff_thread_metrics_t);
+
+	switch (format)
+	{
+		case SCRIMPFF_NATIVE_F32:
+			kernel = scrimp_f32;
+			break;
+		case SCRIMPFF_NATIVE_F16:
+			kernel = scrimp_f16;
+			break;
+		case SCRIMPFF_NATIVE_BF16:
+			kernel = scrimp_bf16;
+			break;
+		default:
+			return -1;
+	}
+
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_NATIVE);
+	kernel(ctx, thread_metrics(ctx, SCRIMPFF_KERNEL_NATIVE));
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_NATIVE);
+	count_cells(ctx);
+	return 0;
+}
+
+/* Fixed point kernel ------------------------------------------------------- */
+typedef struct
+{
+	int64_t lo;
+	int64_t hi;
+	int     wrap;
+} fx_stage_t;
+
+static fx_stage_t fx_stage(scrimpff_q_t q)
+{
+	int bits = 1 + q.m + q.n;
+	return (fx_stage_t) {-((int64_t) 1 << (bits - 1)),
+		((int64_t) 1 << (bits - 1)) - 1, 64 - bits};
+}
+
+static inline int64_t fx_cast(int64_t x, fx_stage_t st, int saturate)
+{
+	/* Clamps or wraps x to the stage format ---------------------------- */
+	int64_t clamped = x < st.lo ? st.lo : (x > st.hi ? st.hi : x);
+	int64_t wrapped = (int64_t) ((uint64_t) x << st.wrap) >> st.wrap;
+	return saturate ? clamped : wrapped;
+}
+
+static inline int64_t fx_fit(int64_t x, fx_stage_t st, int saturate,
+		int64_t * overflows)
+{
+	/* fx_cast, counting overflows -------------------------------------- */
+	*overflows += (x < st.lo) | (x > st.hi);
+	return fx_cast(x, st, saturate);
+}
+
+static inline int64_t fx_shift(int64_t x, int shift, int64_t round)
+{
+	return (x + round) >> shift;
+}
+
+static inline int64_t fx_round(int shift, int nearest)
+{
+	return (nearest && shift > 0) ? (int64_t) 1 << (shift - 1) : 0;
+}
+
+static int64_t fx_quantize(double x, scrimpff_q_t q, fx_stage_t st,
+		const scrimpff_fixed_t * fx, int64_t * overflows)
+{
+	double v = ldexp(x, q.n);
+	v = fx->nearest ? floor(v + 0.5) : floor(v);
+	if (isnan(v)) v = 0;
+	if (v >  0x1p62) v =  0x1p62;
+	if (v < -0x1p62) v = -0x1p62;
+	return fx_fit((int64_t) v, st, fx->saturate, overflows);
+}
+
+static int fx_valid(const scrimpff_fixed_t * fx)
+{
+	const scrimpff_q_t * q[SCRIMPFF_FX_STAGES] = {&fx->series, &fx->dotp,
+		&fx->stats, &fx->dist};
+	const int maxBits[SCRIMPFF_FX_STAGES] = {31, 62, 32, 32};
+
+	for (int i = 0; i < SCRIMPFF_FX_STAGES; i++)
+		if (q[i]->m < 0 || q[i]->n < 0
+			|| 1 + q[i]->m + q[i]->n > maxBits[i])
+			return 0;
+
+	/* Every conversion between stages only drops fractional bits */
+	return fx->dotp.n <= 2 * fx->series.n && fx->dist.n <= fx->dotp.n
+		&& fx->dist.n <= 2 * fx->stats.n;
+}
+
+typedef struct
+{
+	/* Formats, shifts and rounding constants of a fixed point run ------ */
+	fx_stage_t series, dotp, stats, dist;
+	int        shProd, shLastz, shStats, shSigma;
+	int64_t    rdProd, rdLastz, rdStats, rdSigma;
+	int64_t    windowSize;
+	int        win;
+} fx_plan_t;
+
+static inline int64_t fx_dot_update(const fx_plan_t * p, int64_t lastz,
+		int64_t add, int64_t sub, int saturate, int64_t * ovfDotp)
+{
+	/* One step of a diagonal's dot product ----------------------------- */
+	return fx_fit(lastz + fx_shift(add, p->shProd, p->rdProd)
+			- fx_shift(sub, p->shProd, p->rdProd), p->dotp,
+			saturate, ovfDotp);
+}
+
+static inline int32_t fx_lastz_cast(const fx_plan_t * p, int64_t lastz,
+		int saturate, int64_t * ovfDist)
+{
+	/* Dot product to the distance stage -------------------------------- */
+	return (int32_t) fx_fit(fx_shift(lastz, p->shLastz, p->rdLastz),
+			p->dist, saturate, ovfDist);
+}
+
+static inline int64_t fx_distances(const fx_plan_t * p, int len,
+		const int32_t * lastz_casts, const int32_t * AMean_j,
+		const int32_t * AMean_i, const int32_t * AInvSigma_j,
+		const int32_t * AInvSigma_i, int32_t * distances,
+		int64_t * ovfStats, const int saturate)
+{
+	/* Distances of one block of a diagonal, whose dot products are
+	 * FX_LANES apart in lastz_casts. Values are fitted where they enter
+	 * a stage: the mean product to the distance stage (see
+	 * libscrimpff.h), the sigma product, the numerator of the
+	 * correlation and the distance. In between, every operand has at most
+	 * 32 bits and the arithmetic is done in 64 bits without overflow.
+	 * Returns the overflows of the distance stage and adds those of the
+	 * sigma product to ovfStats ---------------------------------------- */
+	int64_t ovf = 0, ovfSigma = 0;
+
+	for (int k = 0; k < len; k++)
+	{
+		int64_t cell = 0, cellSigma = 0;
+		int32_t mean_prods  = fx_fit(fx_shift((int64_t) AMean_j[k]
+				* AMean_i[k], p->shStats, p->rdStats), p->dist,
+				saturate, &cell);
+		int32_t sigma_prods = fx_fit(fx_shift((int64_t) AInvSigma_j[k]
+				* AInvSigma_i[k], p->shSigma, p->rdSigma),
+				p->stats, saturate, &cellSigma);
+		int32_t numerator   = fx_fit(lastz_casts[k * FX_LANES]
+				- (int64_t) mean_prods * p->win, p->dist, saturate,
+				&cell);
+		int64_t corr = fx_shift((int64_t) numerator * sigma_prods,
+				p->shSigma, p->rdSigma);
+
+		/* 2 * (windowSize - corr) may not fit in 64 bits, so it is
+		 * cast before doubling too, which gives the same value. The
+		 * doubled value overflows when half of it is out of range */
+		int64_t half = p->windowSize - corr;
+		cell += (half < p->dist.lo / 2) | (half > p->dist.hi / 2);
+		distances[k] = (int32_t) fx_cast(fx_cast(half, p->dist,
+				saturate) * 2, p->dist, saturate);
+		ovf      += cell;
+		ovfSigma += cellSigma;
+	}
+	*ovfStats += ovfSigma;
+	return ovf;
+}
+
+static void scrimp_fx(scrimpff_ctx_t * ctx, const scrimpff_fixed_t * fx,
+		scrimpff_thread_metrics_t tm)
+{
+	int timeSeriesLength = ctx->timeSeriesLength;
+	int ProfileLength    = ctx->ProfileLength;
+	int exclusionZone    = ctx->exclusionZone;
+	int numThreads       = ctx->numThreads;
+	int win              = ctx->windowSize;
+	int saturate         = fx->saturate;
+	scrimpff_scratch_t * s = ctx->scratch;
+	int * idx            = s->idx;
+	int32_t * tSeries    = (int32_t *) s->tSeries32;
+	int32_t * AMean      = (int32_t *) s->AMean32;
+	int32_t * AInvSigma  = (int32_t *) s->ASigma32;
+	int32_t * profile_priv     = (int32_t *) s->profile_priv32;
+	int     * profileIdxs_priv = s->profileIdxs_priv;
+
+	/* Shifts between stages ------------------------------------------- */
+	fx_plan_t p;
+	p.series  = fx_stage(fx->series);
+	p.dotp    = fx_stage(fx->dotp);
+	p.stats   = fx_stage(fx->stats);
+	p.dist    = fx_stage(fx->dist);
+	p.shProd  = 2 * fx->series.n - fx->dotp.n;
+	p.shLastz = fx->dotp.n - fx->dist.n;
+	p.shStats = 2 * fx->stats.n - fx->dist.n;
+	p.shSigma = fx->stats.n;
+	p.rdProd  = fx_round(p.shProd,  fx->nearest);
+	p.rdLastz = fx_round(p.shLastz, fx->nearest);
+	p.rdStats = fx_round(p.shStats, fx->nearest);
+	p.rdSigma = fx_round(p.shSigma, fx->nearest);
+	p.win     = win;
+	/* ------------------------------------------------------------------ */
+
+	/* Quantizing inputs ------------------------------------------------ */
+	int64_t ovfSeries = 0, ovfStats = 0, ovfDotp = 0, ovfDist = 0;
+
+	for (int i = 0; i < timeSeriesLength; i++)
+		tSeries[i] = fx_quantize(ctx->tSeries[i], fx->series,
+				p.series, fx, &ovfSeries);
+	for (int i = 0; i < ProfileLength; i++)
+	{
+		AMean[i]     = fx_quantize(ctx->AMean[i], fx->stats,
+				p.stats, fx, &ovfStats);
+		AInvSigma[i] = fx_quantize(1.0 / ctx->ASigma[i], fx->stats,
+				p.stats, fx, &ovfStats);
+	}
+	/* Every int32_t is a valid distance, an index of -1 marks the columns
+	 * a thread has not reached yet */
+	for (int i = 0; i < ProfileLength * numThreads; i++)
+	{
+		profile_priv[i]     = INT32_MAX;
+		profileIdxs_priv[i] = -1;
+	}
+
+	p.windowSize = fx_fit((int64_t) win << fx->dist.n, p.dist, saturate,
+			&ovfDist);
+	/* ------------------------------------------------------------------ */
+
+	int numDiagonals = ProfileLength - (exclusionZone + 1);
+
+	#pragma omp parallel num_threads(numThreads) \
+		reduction(+: ovfDotp, ovfStats, ovfDist)
+	{
+		int32_t distances[FX_BLOCK];
+		int64_t lastz[FX_LANES];
+		int subseqs[FX_LANES];
+		int tid      = omp_get_thread_num();
+		int myoffset = tid * ProfileLength;
+		int32_t * lastzs = (int32_t *) s->lastzs32
+			+ (size_t) myoffset * FX_LANES;
+		uint64_t diagonals = 0;
+		uint64_t t0 = scrimpff_now_ns();
+
+		#pragma omp for schedule(dynamic) nowait
+		for (int ri = 0; ri < numDiagonals; ri += FX_LANES)
+		{
+			int lanes = numDiagonals - ri;
+			if (lanes > FX_LANES) lanes = FX_LANES;
+
+			/* Dot products of the lanes, as in scrimp_native.h - */
+			for (int g = 0; g < lanes; g++)
+			{
+				subseqs[g] = idx[ri + g];
+				lastz[g] = 0;
+				for (int w = 0; w < win; w++)
+				{
+					int64_t prod = (int64_t) tSeries[w
+						+ subseqs[g]] * tSeries[w];
+					lastz[g] = fx_fit(lastz[g] + fx_shift(prod,
+						p.shProd, p.rdProd), p.dotp,
+						saturate, &ovfDotp);
+				}
+				lastzs[g] = fx_lastz_cast(&p, lastz[g], saturate,
+						&ovfDist);
+			}
+
+			int i = 1;
+			if (lanes == FX_LANES
+				&& subseqs[FX_LANES - 1] == subseqs[0] + FX_LANES - 1)
+			{
+				int shortest = ProfileLength - subseqs[FX_LANES - 1];
+				int64_t ovfLanesDotp = 0, ovfLanesDist = 0;
+				for (; i < shortest; i++)
+				{
+					const int32_t * tj = tSeries + subseqs[0] + i;
+					int32_t ti_new = tSeries[i + win - 1];
+					int32_t ti_old = tSeries[i - 1];
+					#pragma GCC unroll 1
+					for (int g = 0; g < FX_LANES; g++)
+					{
+						lastz[g] = fx_dot_update(&p, lastz[g],
+							(int64_t) tj[g + win - 1] * ti_new,
+							(int64_t) tj[g - 1] * ti_old, saturate,
+							&ovfLanesDotp);
+						lastzs[i * FX_LANES + g] = fx_lastz_cast(&p,
+							lastz[g], saturate, &ovfLanesDist);
+					}
+				}
+				ovfDotp += ovfLanesDotp;
+				ovfDist += ovfLanesDist;
+			}
+
+			for (int g = 0; g < lanes; g++)
+				for (int k = i; k < ProfileLength - subseqs[g]; k++)
+				{
+					int j = subseqs[g] + k;
+					lastz[g] = fx_dot_update(&p, lastz[g],
+						(int64_t) tSeries[j + win - 1]
+						* tSeries[k + win - 1],
+						(int64_t) tSeries[j - 1]
+						* tSeries[k - 1], saturate, &ovfDotp);
+					lastzs[k * FX_LANES + g] = fx_lastz_cast(&p,
+						lastz[g], saturate, &ovfDist);
+				}
+			/* -------------------------------------------------- */
+
+			for (int g = 0; g < lanes; g++)
+			{
+				int subseq = subseqs[g];
+				diagonals++;
+
+				for (int base = subseq; base < ProfileLength;
+						base += FX_BLOCK)
+				{
+					int len = ProfileLength - base;
+					if (len > FX_BLOCK) len = FX_BLOCK;
+					int b = base - subseq;
+
+					/* Distance calculation (vectorizable) -- */
+					const int32_t * casts = lastzs
+						+ (size_t) b * FX_LANES + g;
+					if (saturate)
+						ovfDist += fx_distances(&p, len, casts,
+							AMean + base, AMean + b,
+							AInvSigma + base, AInvSigma + b,
+							distances, &ovfStats, 1);
+					else
+						ovfDist += fx_distances(&p, len, casts,
+							AMean + base, AMean + b,
+							AInvSigma + base, AInvSigma + b,
+							distances, &ovfStats, 0);
+					/* -------------------------------------- */
+
+					/* Profile update (vectorizable) -------- */
+					int32_t * prof_j = profile_priv + myoffset
+						+ base;
+					int     * idxs_j = profileIdxs_priv + myoffset
+						+ base;
+					for (int k = 0; k < len; k++)
+					{
+						int better = (distances[k] < prof_j[k])
+							| (idxs_j[k] < 0);
+						prof_j[k] = better ? distances[k]
+							: prof_j[k];
+						idxs_j[k] = better ? b + k : idxs_j[k];
+					}
+
+					int32_t * prof_i = prof_j - subseq;
+					int     * idxs_i = idxs_j - subseq;
+					for (int k = 0; k < len; k++)
+					{
+						int better = (distances[k] < prof_i[k])
+							| (idxs_i[k] < 0);
+						prof_i[k] = better ? distances[k]
+							: prof_i[k];
+						idxs_i[k] = better ? base + k : idxs_i[k];
+					}
+					/* -------------------------------------- */
+				}
+			}
+		}
+		uint64_t t1 = scrimpff_now_ns();
+		#pragma omp barrier
+
+		/* Final profile reduction ---------------------------------- */
+		uint64_t t2 = scrimpff_now_ns();
+		#pragma omp for schedule(static) nowait
+		for (int colum = 0; colum < ProfileLength; colum++)
+		{
+			int32_t min_distance = INT32_MAX;
+			int     min_index    = -1;
+
+			for (int row = 0; row < numThreads; row++)
+			{
+				int32_t d = profile_priv[colum + (row * ProfileLength)];
+				int index = profileIdxs_priv[colum
+					+ (row * ProfileLength)];
+				if (index >= 0 && (min_index < 0 || d < min_distance))
+				{
+					min_distance = d;
+					min_index    = index;
+				}
+			}
+			ctx->profile_fixed[colum] = (min_index < 0)
+				? INFINITY : ldexp(min_distance, -fx->dist.n);
+			ctx->profileIdxs_fixed[colum] = min_index < 0 ? 0
+				: min_index;
+		}
+		/* ---------------------------------------------------------- */
+
+		if (tm.diagNs)    tm.diagNs[tid]    = t1 - t0;
+		if (tm.reduceNs)  tm.reduceNs[tid]  = scrimpff_now_ns() - t2;
+		if (tm.diagonals) tm.diagonals[tid] = diagonals;
+	}
+
+	ctx->fixedOverflows[SCRIMPFF_FX_SERIES] = ovfSeries;
+	ctx->fixedOverflows[SCRIMPFF_FX_DOTP]   = ovfDotp;
+	ctx->fixedOverflows[SCRIMPFF_FX_STATS]  = ovfStats;
+	ctx->fixedOverflows[SCRIMPFF_FX_DIST]   = ovfDist;
+}
+
+int scrimpff_run_fixed(scrimpff_ctx_t * ctx, const scrimpff_fixed_t * fx)
+{
+	if (!fx_valid(fx)) return -1;
+
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_FIXED);
+	scrimp_fx(ctx, fx, thread_metrics(ctx, SCRIMPFF_KERNEL_FIXED));
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_FIXED);
+	count_cells(ctx);
+	return 0;
+}
+/* -------------------------------------------------------------------------- */
+
+int scrimpff_read_fixed_config(const char * path, scrimpff_fixed_t * fx)
+{
+	int v[10];
+
+	FILE * file = fopen(path, "r");
+	if (file == NULL) return -1;
+
+	for (int i = 0; i < 10; i++)
+	{
+		if (fscanf(file, "%d", &v[i]) != 1)
+		{
+			fclose(file);
+			return -1;
+		}
+	}
+	fclose(file);
+
+	fx->series   = (scrimpff_q_t) {v[0], v[1]};
+	fx->dotp     = (scrimpff_q_t) {v[2], v[3]};
+	fx->stats    = (scrimpff_q_t) {v[4], v[5]};
+	fx->dist     = (scrimpff_q_t) {v[6], v[7]};
+	fx->saturate = v[8];
+	fx->nearest  = v[9];
+	return fx_valid(fx) ? 0 : -1;
+}
+
+int scrimpff_desc_valid(flexfloat_desc_t desc)
+{
+	return desc.exp_bits >= 1 && desc.exp_bits <= SCRIMPFF_MAX_EXP_BITS
+		&& desc.frac_bits <= SCRIMPFF_MAX_FRAC_BITS;
+}
+
+int scrimpff_read_config(const char * path, scrimpff_prec_t * prec)
+{
+	unsigned v[8];
+
+	FILE * file = fopen(path, "r");
+	if (file == NULL) return -1;
+
+	for (int i = 0; i < 8; i++)
+	{
+		if (fscanf(file, "%u", &v[i]) != 1)
+		{
+			fclose(file);
+			return -1;
+		}
+	}
+	fclose(file);
+
+	for (int i = 0; i < 8; i++)
+		if (v[i] > 255) return -1;
+
+	prec->dist  = (flexfloat_desc_t) {v[0], v[1]};
+	prec->dotp  = (flexfloat_desc_t) {v[2], v[3]};
+	prec->stats = (flexfloat_desc_t) {v[4], v[5]};
+	prec->prof  = (flexfloat_desc_t) {v[6], v[7]};
+	return scrimpff_desc_valid(prec->dist) && scrimpff_desc_valid(prec->dotp)
+		&& scrimpff_desc_valid(prec->stats)
+		&& scrimpff_desc_valid(prec->prof) ? 0 : -1;
+}
+
+static void scrimp(double * tSeries,  double * AMean, double * ASigma,
+		int timeSeriesLength, int ProfileLength,
+		int windowSize, int* idx, double * profile, int * profileIndex,
+	       	int exclusionZone, int numThreads,
+		double * profile_tmp, int * profileIndex_tmp,
+		scrimpff_thread_metrics_t tm)
+{
+	/* Private structures initialization -------------------------------- */
+	for(int i = 0; i < ProfileLength * numThreads; i++)
+	{
+		profile_tmp[i]      = INFINITY;
+		profileIndex_tmp[i] = 0;
+	}
+	/* ------------------------------------------------------------------ */
+
+	#pragma omp parallel num_threads(numThreads)
+	{
+		double distance, windowSizeDTYPE, lastz;
+
+		int diag, my_offset, i, j, ri;
+
+		windowSizeDTYPE = (double) windowSize;
+
+		int tid = omp_get_thread_num();
+		my_offset = tid * ProfileLength;
+		uint64_t diagonals = 0;
+		uint64_t t0 = scrimpff_now_ns();
+
+		#pragma omp for schedule(dynamic) nowait
+		for (ri = 0; ri < (ProfileLength - (exclusionZone + 1)); ri++)
+		{
+			diag = idx[ri];
+			lastz = 0;
+			diagonals++;
+
+			/* Dot product calculation -------------------------- */
+			for (j = diag; j < windowSize + diag; j++)
+			{
+				lastz += tSeries[j] * tSeries[j - diag];
+			}
+
+			j = diag;
+			i = 0;
+
+			/* Distance calculation ----------------------------- */
+			distance = 2 * (windowSizeDTYPE - (lastz -
+				windowSizeDTYPE * AMean[j] * AMean[i]) /
+				(ASigma[j] * ASigma[i]));
+
+			/* -------------------------------------------------- */
+
+			/* Profile update ----------------------------------- */
+			if (distance < profile_tmp[my_offset + j])
+			{
+				profile_tmp[my_offset + j]     = distance;
+				profileIndex_tmp [my_offset+j] = i;
+			}
+			if (distance < profile_tmp[my_offset + i])
+			{
+				profile_tmp[my_offset + i]       = distance;
+				profileIndex_tmp [my_offset + i] = j;
+			}
+			/* -------------------------------------------------- */
+			i = 1;
+
+			for(j = diag + 1; j< ProfileLength; j++)
+			{
+				/* Dot product update ----------------------- */
+				lastz += (tSeries[j + windowSize - 1] *
+					tSeries[i + windowSize - 1]) -
+					(tSeries[j - 1] * tSeries[i - 1]);
+				/* ------------------------------------------ */
+
+				/* Distance calculation --------------------- */
+				distance =  2 * (windowSizeDTYPE - (lastz -
+					AMean[j]  * AMean[i] * windowSizeDTYPE)
+					/ (ASigma[j] * ASigma[i]));
+				/* ------------------------------------------ */
+
+				/* Profile update --------------------------- */
+				if (distance < profile_tmp[my_offset + j])
+				{
+					profile_tmp[my_offset + j] = distance;
+					profileIndex_tmp [my_offset+ j] = i;
+				}
+
+				if (distance < profile_tmp[my_offset + i])
+				{
+					profile_tmp[my_offset + i] = distance;
+					profileIndex_tmp[my_offset + i] = j;
+				}
+				/* ------------------------------------------ */
+				i++;
+			}
+
+		}
+		uint64_t t1 = scrimpff_now_ns();
+
+		#pragma omp barrier
+
+		/* Final profile reduction ---------------------------------- */
+		double min_distance;
+		int min_index;
+		uint64_t t2 = scrimpff_now_ns();
+
+		#pragma omp for schedule(static) nowait
+		for (int colum = 0; colum < ProfileLength; colum++)
+		{
+			min_distance = INFINITY;
+
+			min_index = 0;
+
+			for(int row = 0; row < numThreads; row++)
+			{
+				if(profile_tmp[colum + (row*ProfileLength)]
+						< min_distance)
+				{
+					min_distance = profile_tmp[colum +
+						(row * ProfileLength)];
+					min_index    = profileIndex_tmp[colum
+						+ (row * ProfileLength)];
+				}
+			}
+			profile[colum]      = min_distance;
+			profileIndex[colum] = min_index;
+		}
+		uint64_t t3 = scrimpff_now_ns();
+		#pragma omp barrier
+		/* ---------------------------------------------------------- */
+
+		if (tm.diagNs)    tm.diagNs[tid]    = t1 - t0;
+		if (tm.reduceNs)  tm.reduceNs[tid]  = t3 - t2;
+		if (tm.diagonals) tm.diagonals[tid] = diagonals;
+	}
+}
+
+static void scrimp_ff(flexfloat_t * tSeries, flexfloat_t* AMean, flexfloat_t* ASigma,
+		int timeSeriesLength,int ProfileLength,	flexfloat_t windowSize,
+		int* idx, flexfloat_t * profile, int* profileIdxs,
+		int exclusionZone, int numThreads, const scrimpff_prec_t * prec,
+		flexfloat_t * profile_priv, int * profileIdxs_priv,
+		scrimpff_thread_metrics_t tm)
+{
+
+	/* windowSize may not be representable in the distance format */
+	int win = timeSeriesLength - ProfileLength + 1;
+
+	/* Private structures initilization --------------------------------- */
+	for(int i = 0; i < timeSeriesLength * numThreads; i++)
+	{
+		ff_init_double(&profile_priv[i], INFINITY, prec->prof);
+		profileIdxs_priv[i] = 0;
+	}
+	/* ------------------------------------------------------------------ */
+
+	#pragma omp parallel num_threads(numThreads)
+	{
+		flexfloat_t substr;
+		flexfloat_t distance;
+		flexfloat_t sigma_prods;
+		flexfloat_t mean_prods;
+		flexfloat_t constant_2;
+		flexfloat_t lastz;
+		flexfloat_t lastz_cast;
+		flexfloat_t dist_cast;
+		flexfloat_t mean_cast;
+		flexfloat_t sigma_cast;
+		int tid      = omp_get_thread_num();
+		int myoffset = tid * timeSeriesLength;
+		uint64_t diagonals = 0;
+
+		ff_init_double(&substr, 0, prec->dotp);
+		ff_init_double(&distance, 0, prec->dist);
+		ff_init_double(&mean_prods, 0, prec->stats);
+		ff_init_double(&sigma_prods, 0, prec->stats);
+		ff_init_double(&constant_2, 2.0, prec->dist);
+		uint64_t t0 = scrimpff_now_ns();
+
+		#pragma omp for schedule(dynamic) nowait
+		for (int ri = 0; ri < (ProfileLength -
+					(exclusionZone + 1)); ri++)
+		{
+			int subseq = idx[ri];
+			diagonals++;
+
+			/* Dot product calculation -------------------------- */
+			ff_init_double(&lastz,0, prec->dotp);
+			for (int w = 0; w < win; w++)
+			{
+				ff_fma(&lastz,  &tSeries[w + subseq],
+						&tSeries[w], &lastz);
+			}
+			ff_cast(&lastz_cast, &lastz, prec->dist);
+			/* -------------------------------------------------- */
+
+			/* Distance calculation ----------------------------- */
+                        ff_mul(&sigma_prods, &ASigma[subseq], &ASigma[0]);
+			ff_mul(&mean_prods, &AMean[subseq], &AMean [0]);
+			ff_cast(&mean_cast, &mean_prods, prec->dist);
+                        ff_cast(&sigma_cast, &sigma_prods, prec->dist);
+   			ff_mul(&distance,    &mean_cast,   &windowSize);
+                        ff_sub(&distance,    &lastz_cast, &distance);
+                        ff_div(&distance,    &distance,   &sigma_cast);
+                        ff_sub(&distance,    &windowSize, &distance);
+                        ff_mul(&distance,    &distance,   &constant_2);
+			/* -------------------------------------------------- */
+
+			/* Profile update ----------------------------------- */
+			ff_cast(&dist_cast, &distance, prec->prof);
+			if (ff_lt(&dist_cast, &profile_priv[subseq + myoffset]))
+			{
+				profile_priv[subseq + myoffset]     = dist_cast;
+				profileIdxs_priv[subseq + myoffset] = 0;
+			}
+			if (ff_lt(&dist_cast, &profile_priv[myoffset]))
+			{
+				profile_priv[myoffset]     = dist_cast;
+				profileIdxs_priv[myoffset] = subseq;
+			}
+			/* -------------------------------------------------- */
+			int i = 1;
+
+			for(int j = subseq + 1; j< ProfileLength; j++)
+			{
+				/* Dot product update ----------------------- */
+				ff_fma(&lastz,  &tSeries[j + win - 1],
+						&tSeries[i + win - 1],  &lastz);
+				ff_mul(&substr, &tSeries[j - 1],
+						&tSeries[ i - 1]);
+				ff_sub(&lastz,  &lastz, &substr);
+				ff_cast(&lastz_cast, &lastz, prec->dist);
+				/* ------------------------------------------ */
+
+				/* Distance calculation --------------------- */
+				ff_mul(&sigma_prods, &ASigma[j],  &ASigma[i]);
+				ff_mul(&mean_prods,  &AMean[j],   &AMean [i]);
+                        	ff_cast(&mean_cast, &mean_prods, prec->dist);
+                        	ff_cast(&sigma_cast, &sigma_prods, prec->dist);
+				ff_mul(&distance,    &mean_cast,  &windowSize);
+				ff_sub(&distance,    &lastz_cast, &distance);
+				ff_div(&distance,    &distance,   &sigma_cast);
+				ff_sub(&distance,    &windowSize, &distance);
+				ff_mul(&distance,    &distance,   &constant_2);
+				/* ------------------------------------------ */
+
+				/* Profile update --------------------------- */
+				ff_cast(&dist_cast, &distance,prec->prof);
+				if (ff_lt(&dist_cast,&profile_priv[j+myoffset]))
+				{
+					profile_priv[j + myoffset]  = dist_cast;
+					profileIdxs_priv[j+myoffset] = i;
+				}
+				if (ff_lt(&dist_cast,&profile_priv[i+myoffset]))
+				{
+					profile_priv[i + myoffset]  = dist_cast;
+					profileIdxs_priv[i+myoffset] = j;
+				}
+				/* ------------------------------------------ */
+				i++;
+			}
+
+		}
+		uint64_t t1 = scrimpff_now_ns();
+		#pragma omp barrier
+
+		/* Final profile reduction ---------------------------------- */
+		flexfloat_t min_distance;
+		uint64_t t2 = scrimpff_now_ns();
+		#pragma omp for schedule(static) nowait
+		for (int colum = 0; colum < ProfileLength; colum++)
+		{
+			ff_init_double(&min_distance,  INFINITY, prec->prof);
+			int min_index = 0;
+
+			for(int row = 0; row < numThreads; row++)
+			{
+				if(ff_lt(&profile_priv[colum +
+					(row*timeSeriesLength)], &min_distance))
+				{
+					min_distance = profile_priv[colum +
+						(row *	timeSeriesLength)];
+					min_index    = profileIdxs_priv[colum +
+					       	(row * timeSeriesLength)];
+				}
+			}
+			profile[colum]     = min_distance;
+			profileIdxs[colum] = min_index;
+		}
+		uint64_t t3 = scrimpff_now_ns();
+		#pragma omp barrier
+		/* ---------------------------------------------------------- */
+
+		if (tm.diagNs)    tm.diagNs[tid]    = t1 - t0;
+		if (tm.reduceNs)  tm.reduceNs[tid]  = t3 - t2;
+		if (tm.diagonals) tm.diagonals[tid] = diagonals;
+	}
+}
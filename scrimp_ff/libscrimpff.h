@@ -0,0 +1,244 @@
+/* #############################################################################
+libscrimpff: SCRIMP and SCRIMP FlexFloat matrix profile kernels as a library.
+
+All the state of a job lives in a scrimpff_ctx_t. The context owns a single
+arena holding the time series, its statistics, the per-thread private profiles
+and the output profiles. The arena is sized by a power-of-two size class of the
+time series length, so a long-running process can keep one context per worker
+and run consecutive jobs of similar length without touching the allocator.
+Only the job parameters and the outputs are part of scrimpff_ctx_t, the arena
+and the scratch of the kernels are private to the library.
+
+Precision formats are passed to the kernels as a scrimpff_prec_t, there is no
+global state in the library.
+
+Usage:
+	scrimpff_ctx_t * ctx = scrimpff_ctx_create(numThreads);
+	double * tSeries     = scrimpff_series(ctx, length, windowSize);
+	... fill tSeries ...
+	scrimpff_preprocess(ctx);
+	scrimpff_run_ff(ctx, &prec);
+	scrimpff_run(ctx);
+	... read ctx->profile_ff, ctx->profileIdxs_ff, ctx->profile, ...
+	scrimpff_ctx_destroy(ctx);
+############################################################################# */
+
+#ifndef LIBSCRIMPFF_H
+#define LIBSCRIMPFF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "../flexfloat/include/flexfloat.h"
+
+#define EXCLUSION_FACTOR 4
+
+/* Widest FlexFloat format, the double it is backed by --------------------- */
+#define SCRIMPFF_MAX_EXP_BITS  11
+#define SCRIMPFF_MAX_FRAC_BITS 52
+
+/* FlexFloat formats used by each stage of the reduced precision kernel ----- */
+typedef struct
+{
+	flexfloat_desc_t dist;
+	flexfloat_desc_t dotp;
+	flexfloat_desc_t stats;
+	flexfloat_desc_t prof;
+} scrimpff_prec_t;
+
+/* Formats with a native SCRIMP kernel (scrimpff_run_native) --------------- */
+typedef enum
+{
+	SCRIMPFF_NATIVE_NONE = 0,
+	SCRIMPFF_NATIVE_F32,     /* binary32, FlexFloat (8, 23)              */
+	SCRIMPFF_NATIVE_F16,     /* binary16, FlexFloat (5, 10)              */
+	SCRIMPFF_NATIVE_BF16     /* bfloat16, FlexFloat (8, 7)               */
+} scrimpff_native_t;
+
+/* Fixed point Qm.n format: sign, m integer bits and n fractional bits ------ */
+typedef struct
+{
+	int m;
+	int n;
+} scrimpff_q_t;
+
+/* Fixed point formats used by each stage of the fixed point kernel --------- */
+typedef struct
+{
+	scrimpff_q_t series;     /* up to 31 bits                            */
+	scrimpff_q_t dotp;       /* up to 62 bits, n <= 2 * series.n         */
+	scrimpff_q_t stats;      /* mean and 1/sigma, up to 32 bits          */
+	scrimpff_q_t dist;       /* up to 32 bits, n <= dotp.n, 2 * stats.n  */
+	int          saturate;   /* 1: clamp on overflow, 0: wrap around     */
+	int          nearest;    /* 1: round to nearest, 0: truncate         */
+} scrimpff_fixed_t;
+
+/* Unlike scrimp_ff(), the fixed point kernel does not round the mean product
+ * to the statistics stage. The stage is sized for the mean, and the product
+ * of two means needs twice its integer bits: with the Q7.24 statistics of the
+ * shipped .qcfg files, means up to 100 give products up to 10^4, which would
+ * saturate. The product goes straight to the distance stage, which already
+ * holds window_size times it in the numerator of the correlation, so its
+ * overflows are counted under SCRIMPFF_FX_DIST. The 1/sigma product stays
+ * in the statistics range and is rounded and counted there. */
+
+enum
+{
+	SCRIMPFF_FX_SERIES = 0,
+	SCRIMPFF_FX_DOTP,
+	SCRIMPFF_FX_STATS,
+	SCRIMPFF_FX_DIST,
+	SCRIMPFF_FX_STAGES
+};
+
+/* Timed phases of a job --------------------------------------------------- */
+typedef enum
+{
+	SCRIMPFF_PHASE_ALLOC = 0,    /* arena growth                         */
+	SCRIMPFF_PHASE_COUNT_LINES,  /* set by the caller                    */
+	SCRIMPFF_PHASE_LOAD,         /* set by the caller                    */
+	SCRIMPFF_PHASE_PREPROCESS,
+	SCRIMPFF_PHASE_FF_CONVERT,
+	SCRIMPFF_PHASE_FF_KERNEL,
+	SCRIMPFF_PHASE_KERNEL,
+	SCRIMPFF_PHASE_NATIVE,
+	SCRIMPFF_PHASE_FIXED,
+	SCRIMPFF_PHASE_SCAN,         /* set by the caller                    */
+	SCRIMPFF_PHASE_WRITE,        /* set by the caller                    */
+	SCRIMPFF_PHASES
+} scrimpff_phase_t;
+
+/* Kernels with per-thread timings ------------------------------------------ */
+typedef enum
+{
+	SCRIMPFF_KERNEL_DOUBLE = 0,
+	SCRIMPFF_KERNEL_FF,
+	SCRIMPFF_KERNEL_NATIVE,
+	SCRIMPFF_KERNEL_FIXED,
+	SCRIMPFF_KERNELS
+} scrimpff_kernel_t;
+
+typedef enum
+{
+	SCRIMPFF_METRICS_JSON = 0,
+	SCRIMPFF_METRICS_PROMETHEUS
+} scrimpff_metrics_format_t;
+
+/* Instrumentation of a context, accumulated until scrimpff_metrics_reset --- */
+typedef struct
+{
+	uint64_t   phaseNs[SCRIMPFF_PHASES];      /* total                    */
+	uint64_t   phaseLastNs[SCRIMPFF_PHASES];  /* last call                */
+	uint64_t   phaseCalls[SCRIMPFF_PHASES];
+	uint64_t   phaseStart[SCRIMPFF_PHASES];
+	uint64_t   cells;
+	uint64_t   diagonals;
+	uint64_t   bytesRead;                     /* set by the caller        */
+	uint64_t   bytesWritten;                  /* set by the caller        */
+	uint64_t * threadDiagNs;    /* [SCRIMPFF_KERNELS][numThreads], last run */
+	uint64_t * threadReduceNs;
+	uint64_t * threadDiagonals;
+} scrimpff_metrics_t;
+
+/* Arena views and scratch of the kernels, private to the library ---------- */
+typedef struct scrimpff_scratch scrimpff_scratch_t;
+
+/* Persistent SCRIMP context ------------------------------------------------ */
+typedef struct
+{
+	/* Job parameters --------------------------------------------------- */
+	int    numThreads;
+	int    timeSeriesLength;
+	int    windowSize;
+	int    ProfileLength;
+	int    exclusionZone;
+	double tSeriesMin;
+	double tSeriesMax;
+	unsigned long long fixedOverflows[SCRIMPFF_FX_STAGES];
+	scrimpff_metrics_t metrics;
+
+	/* Arena ------------------------------------------------------------ */
+	size_t arenaBytes;
+	int    capacity;
+
+	/* Series, statistics and outputs (views into the arena) ------------ */
+	double      * tSeries;
+	double      * AMean;
+	double      * ASigma;
+	double      * profile;
+	int         * profileIdxs;
+	flexfloat_t * profile_ff;
+	int         * profileIdxs_ff;
+	double      * profile_native;
+	int         * profileIdxs_native;
+	double      * profile_fixed;
+	int         * profileIdxs_fixed;
+
+	/* Private profiles and scratch. Their layout is not part of the
+	 * interface and changes between versions of the library ----------- */
+	scrimpff_scratch_t * scratch;
+} scrimpff_ctx_t;
+
+scrimpff_ctx_t * scrimpff_ctx_create(int numThreads);
+void             scrimpff_ctx_destroy(scrimpff_ctx_t * ctx);
+
+/* Sets the job size, growing the arena only when the size class changes, and
+ * returns the buffer the time series has to be written to (NULL on error). */
+double * scrimpff_series(scrimpff_ctx_t * ctx, int timeSeriesLength,
+		int windowSize);
+
+/* Same as scrimpff_series, but the kernels read the time series straight from
+ * the caller's buffer, which must stay alive while the context uses it.
+ * Returns 0 on success, -1 on error. */
+int scrimpff_set_series(scrimpff_ctx_t * ctx, double * tSeries,
+		int timeSeriesLength, int windowSize);
+
+/* Computes mean, sigma, min/max and the diagonal list of the loaded series.
+ * Returns 0 on success, -1 if the window does not fit the series. */
+int  scrimpff_preprocess(scrimpff_ctx_t * ctx);
+
+/* Double precision SCRIMP, results in profile/profileIdxs. */
+void scrimpff_run(scrimpff_ctx_t * ctx);
+
+/* FlexFloat SCRIMP, results in profile_ff/profileIdxs_ff. */
+void scrimpff_run_ff(scrimpff_ctx_t * ctx, const scrimpff_prec_t * prec);
+
+/* Native format whose (exp, man) all four stages of prec use, if any. */
+scrimpff_native_t scrimpff_native_format(const scrimpff_prec_t * prec);
+
+/* SCRIMP computed in a native format, results in profile_native and
+ * profileIdxs_native. They match scrimpff_run_ff() with the equivalent
+ * FlexFloat formats. Returns 0 on success, -1 if the format is not
+ * supported by the compiler. */
+int  scrimpff_run_native(scrimpff_ctx_t * ctx, scrimpff_native_t format);
+
+/* SCRIMP computed in fixed point, results in profile_fixed/profileIdxs_fixed
+ * and the values that did not fit their stage format in fixedOverflows.
+ * Returns 0 on success, -1 if the formats are not valid. */
+int  scrimpff_run_fixed(scrimpff_ctx_t * ctx, const scrimpff_fixed_t * fx);
+
+/* Reads a .qcfg fixed point file. Returns 0 on success, -1 on error. */
+int  scrimpff_read_fixed_config(const char * path, scrimpff_fixed_t * fx);
+
+/* 1 if a FlexFloat format has 1..11 exponent and 0..52 fraction bits. */
+int  scrimpff_desc_valid(flexfloat_desc_t desc);
+
+/* Reads a .cfg precision file. Returns 0 on success, -1 on error or if a
+ * format is not valid. */
+int  scrimpff_read_config(const char * path, scrimpff_prec_t * prec);
+
+/* Monotonic clock in nanoseconds. */
+uint64_t scrimpff_now_ns(void);
+
+/* Phase timers, scrimpff_phase_end returns the elapsed nanoseconds. The
+ * library times its own phases, callers time the ones marked above. */
+void     scrimpff_phase_begin(scrimpff_ctx_t * ctx, scrimpff_phase_t phase);
+uint64_t scrimpff_phase_end(scrimpff_ctx_t * ctx, scrimpff_phase_t phase);
+
+void scrimpff_metrics_reset(scrimpff_ctx_t * ctx);
+
+/* Writes the metrics as JSON or Prometheus text. Returns 0 on success. */
+int  scrimpff_metrics_write(const scrimpff_ctx_t * ctx, FILE * out,
+		scrimpff_metrics_format_t format);
+
+#endif
@@ -14,17 +14,38 @@ with open('../configs/' +  sys.argv[1] + '.cfg','r') as f:
     for line in range(4): # read rest of lines
         array.append([int(x) for x in next(f).split()])
 
-with open('../results/result_' +  sys.argv[1] + '.csv','r') as csvfile:
-    plots = csv.reader(csvfile, delimiter=',')
-    for row in plots:
-        ticks.append(int(row[0]))
-        tSeries.append(float(row[1]))
-        mProfile_ff.append(float(row[2]))
-        mProfile.append(float(row[4]))
-        if float(row[6]) > 100:
-            error.append(float(0))
-        else:
-            error.append(float(row[6]))
+if len(sys.argv) >= 4:
+    # python plot.py name window_size num_threads [scale_factor]
+    # Runs SCRIMP in memory through the scrimpff module (make python)
+    import numpy as np
+    import scrimpff
+
+    scale = float(sys.argv[4]) if len(sys.argv) > 4 else 1.0
+    series = np.loadtxt('../timeseries/' + sys.argv[1] + '.txt') * scale
+    ctx = scrimpff.Context(int(sys.argv[3]))
+    ctx.load(series, int(sys.argv[2]))
+    profile_ff, _ = ctx.run_ff(dist=tuple(array[0]), dotp=tuple(array[1]),
+                               stats=tuple(array[2]), prof=tuple(array[3]))
+    profile, _ = ctx.run()
+
+    ticks = np.arange(ctx.profile_length)
+    tSeries = series[:ctx.profile_length]
+    mProfile_ff = np.sqrt(profile_ff)
+    mProfile = np.sqrt(profile)
+    error = np.abs(mProfile - mProfile_ff) / mProfile * 100
+    error[error > 100] = 0
+else:
+    with open('../results/result_' +  sys.argv[1] + '.csv','r') as csvfile:
+        plots = csv.reader(csvfile, delimiter=',')
+        for row in plots:
+            ticks.append(int(row[0]))
+            tSeries.append(float(row[1]))
+            mProfile_ff.append(float(row[2]))
+            mProfile.append(float(row[4]))
+            if float(row[6]) > 100:
+                error.append(float(0))
+            else:
+                error.append(float(row[6]))
 
 
 plt.figure(figsize=(11,8))
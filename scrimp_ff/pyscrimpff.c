@@ -0,0 +1,409 @@
+/* #############################################################################
+scrimpff: Python bindings for libscrimpff.
+
+The time series is taken from a float64 numpy array without copying it (arrays
+that are not C-contiguous float64 are converted once). The kernels run with the
+GIL released and the results are returned as numpy views over the context
+buffers, so no data goes through text files.
+
+Usage:
+	import numpy, scrimpff
+	ctx = scrimpff.Context(num_threads)
+	ctx.load(series, window_size)
+	profile_ff, index_ff = ctx.run_ff(dist=(6, 15), dotp=(6, 15),
+	                                  stats=(6, 15), prof=(6, 15))
+	profile, index       = ctx.run()
+	report               = ctx.metrics()       # JSON, or metrics("prometheus")
+
+The statistics are computed by load(), so the series must not change until the
+next load(). While the context holds the caller's array it is made read-only,
+and write access is given back when another series is loaded or the context
+is released. Other arrays sharing its memory (its base, other views) are not
+locked and must not be written either.
+
+Profiles hold squared z-normalized distances, as in the CSV writer of the
+command line tool. The returned views are overwritten by the next run of the
+same kernel; load() refuses to grow the arena while any view is still alive.
+############################################################################# */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <numpy/arrayobject.h>
+#include "libscrimpff.h"
+
+_Static_assert(sizeof(((flexfloat_t *) 0)->value) == sizeof(double),
+		"FlexFloat must store its values as double");
+
+typedef struct
+{
+	PyObject_HEAD
+	scrimpff_ctx_t * ctx;
+	PyArrayObject  * series;
+	PyObject       * views;
+	int              busy;
+	int              locked;   /* series is the caller's, made read-only */
+} ContextObject;
+
+static void release_series(ContextObject * self)
+{
+	/* Gives write access back to the array locked by load() ------------ */
+	if (self->series != NULL && self->locked)
+		PyArray_ENABLEFLAGS(self->series, NPY_ARRAY_WRITEABLE);
+	self->locked = 0;
+	Py_CLEAR(self->series);
+}
+
+static int live_views(ContextObject * self)
+{
+	/* Drops dead weak references and returns how many views are alive -- */
+	Py_ssize_t i = 0;
+	while (i < PyList_GET_SIZE(self->views))
+	{
+		PyObject * view = PyWeakref_GetObject(
+				PyList_GET_ITEM(self->views, i));
+		if (view == Py_None)
+		{
+			if (PySequence_DelItem(self->views, i)) return -1;
+		}
+		else i++;
+	}
+	return (int) PyList_GET_SIZE(self->views);
+}
+
+static int Context_init(ContextObject * self, PyObject * args, PyObject * kwds)
+{
+	static char * kwlist[] = {"num_threads", NULL};
+	int numThreads = 1;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &numThreads))
+		return -1;
+
+	/* Another thread may be running a kernel with the GIL released */
+	if (self->busy)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Context is running a kernel");
+		return -1;
+	}
+
+	if (self->views != NULL && live_views(self) != 0)
+	{
+		if (!PyErr_Occurred())
+			PyErr_SetString(PyExc_BufferError, "cannot reinitialize "
+				"while result views are alive");
+		return -1;
+	}
+
+	scrimpff_ctx_destroy(self->ctx);
+	self->ctx = scrimpff_ctx_create(numThreads);
+	if (self->ctx == NULL)
+	{
+		PyErr_SetString(PyExc_ValueError, "num_threads must be positive");
+		return -1;
+	}
+
+	release_series(self);
+	Py_XSETREF(self->views, PyList_New(0));
+	return self->views ? 0 : -1;
+}
+
+static void Context_dealloc(ContextObject * self)
+{
+	scrimpff_ctx_destroy(self->ctx);
+	release_series(self);
+	Py_XDECREF(self->views);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject * make_view(ContextObject * self, void * data, int length,
+		int type, npy_intp stride)
+{
+	/* Wraps a context buffer as an array that keeps the context alive --- */
+	npy_intp dims[1]    = {length};
+	npy_intp strides[1] = {stride};
+
+	PyObject * view = PyArray_New(&PyArray_Type, 1, dims, type, strides,
+			data, 0, NPY_ARRAY_ALIGNED, NULL);
+	if (view == NULL) return NULL;
+
+	Py_INCREF(self);
+	if (PyArray_SetBaseObject((PyArrayObject *) view, (PyObject *) self))
+	{
+		Py_DECREF(view);
+		return NULL;
+	}
+
+	PyObject * ref = PyWeakref_NewRef(view, NULL);
+	if (ref == NULL || PyList_Append(self->views, ref))
+	{
+		Py_XDECREF(ref);
+		Py_DECREF(view);
+		return NULL;
+	}
+	Py_DECREF(ref);
+	return view;
+}
+
+static int check_idle(ContextObject * self)
+{
+	if (self->ctx == NULL)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Context not initialized");
+		return -1;
+	}
+	if (self->busy)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Context is running a kernel");
+		return -1;
+	}
+	return 0;
+}
+
+static PyObject * Context_load(ContextObject * self, PyObject * args)
+{
+	PyObject * obj;
+	int windowSize;
+
+	if (!PyArg_ParseTuple(args, "Oi", &obj, &windowSize)) return NULL;
+	if (check_idle(self)) return NULL;
+
+	PyArrayObject * series = (PyArrayObject *) PyArray_FROM_OTF(obj,
+			NPY_FLOAT64, NPY_ARRAY_IN_ARRAY);
+	if (series == NULL) return NULL;
+
+	npy_intp length = PyArray_SIZE(series);
+	if (PyArray_NDIM(series) != 1 || length > INT_MAX)
+	{
+		Py_DECREF(series);
+		PyErr_SetString(PyExc_ValueError,
+				"series must be a one dimensional array");
+		return NULL;
+	}
+
+	/* Growing the arena would leave the exported views dangling -------- */
+	int views = live_views(self);
+	if (views < 0 || (length > self->ctx->capacity && views > 0))
+	{
+		Py_DECREF(series);
+		if (views >= 0)
+			PyErr_SetString(PyExc_BufferError, "cannot load a "
+				"longer series while result views are alive");
+		return NULL;
+	}
+	/* ------------------------------------------------------------------ */
+
+	/* The previous series may be this same array, unlock it first */
+	release_series(self);
+
+	if (scrimpff_set_series(self->ctx, (double *) PyArray_DATA(series),
+				(int) length, windowSize)
+			|| scrimpff_preprocess(self->ctx))
+	{
+		Py_DECREF(series);
+		PyErr_SetString(PyExc_ValueError, "invalid series length or "
+				"window size");
+		return NULL;
+	}
+
+	/* The statistics are only valid for the current values ------------- */
+	if ((PyObject *) series == obj && PyArray_ISWRITEABLE(series))
+	{
+		PyArray_CLEARFLAGS(series, NPY_ARRAY_WRITEABLE);
+		self->locked = 1;
+	}
+	/* ------------------------------------------------------------------ */
+
+	self->series = series;
+	Py_RETURN_NONE;
+}
+
+static PyObject * Context_run(ContextObject * self, PyObject * noargs)
+{
+	if (check_idle(self)) return NULL;
+	if (self->series == NULL)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "no series loaded");
+		return NULL;
+	}
+
+	self->busy = 1;
+	Py_BEGIN_ALLOW_THREADS
+	scrimpff_run(self->ctx);
+	Py_END_ALLOW_THREADS
+	self->busy = 0;
+
+	scrimpff_ctx_t * ctx = self->ctx;
+	PyObject * profile = make_view(self, ctx->profile, ctx->ProfileLength,
+			NPY_FLOAT64, sizeof(double));
+	PyObject * index   = make_view(self, ctx->profileIdxs,
+			ctx->ProfileLength, NPY_INT, sizeof(int));
+	if (profile == NULL || index == NULL)
+	{
+		Py_XDECREF(profile);
+		Py_XDECREF(index);
+		return NULL;
+	}
+	return Py_BuildValue("(NN)", profile, index);
+}
+
+static int parse_desc(PyObject * obj, flexfloat_desc_t * desc)
+{
+	unsigned char exp_bits, frac_bits;
+
+	if (!PyArg_ParseTuple(obj, "bb", &exp_bits, &frac_bits)) return 0;
+	*desc = (flexfloat_desc_t) {exp_bits, frac_bits};
+	if (!scrimpff_desc_valid(*desc))
+	{
+		PyErr_Format(PyExc_ValueError, "format (%d, %d) needs 1..%d "
+			"exponent and 0..%d fraction bits", exp_bits, frac_bits,
+			SCRIMPFF_MAX_EXP_BITS, SCRIMPFF_MAX_FRAC_BITS);
+		return 0;
+	}
+	return 1;
+}
+
+static PyObject * Context_run_ff(ContextObject * self, PyObject * args,
+		PyObject * kwds)
+{
+	static char * kwlist[] = {"dist", "dotp", "stats", "prof", NULL};
+	scrimpff_prec_t prec;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&O&O&O&", kwlist,
+				parse_desc, &prec.dist, parse_desc, &prec.dotp,
+				parse_desc, &prec.stats, parse_desc, &prec.prof))
+		return NULL;
+	if (check_idle(self)) return NULL;
+	if (self->series == NULL)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "no series loaded");
+		return NULL;
+	}
+
+	self->busy = 1;
+	Py_BEGIN_ALLOW_THREADS
+	scrimpff_run_ff(self->ctx, &prec);
+	Py_END_ALLOW_THREADS
+	self->busy = 0;
+
+	scrimpff_ctx_t * ctx = self->ctx;
+	PyObject * profile = make_view(self,
+			(char *) ctx->profile_ff + offsetof(flexfloat_t, value),
+			ctx->ProfileLength, NPY_FLOAT64, sizeof(flexfloat_t));
+	PyObject * index   = make_view(self, ctx->profileIdxs_ff,
+			ctx->ProfileLength, NPY_INT, sizeof(int));
+	if (profile == NULL || index == NULL)
+	{
+		Py_XDECREF(profile);
+		Py_XDECREF(index);
+		return NULL;
+	}
+	return Py_BuildValue("(NN)", profile, index);
+}
+
+static PyObject * Context_metrics(ContextObject * self, PyObject * args)
+{
+	const char * format = "json";
+	char * text = NULL;
+	size_t size = 0;
+
+	if (!PyArg_ParseTuple(args, "|s", &format)) return NULL;
+	if (check_idle(self)) return NULL;
+
+	scrimpff_metrics_format_t fmt;
+	if (strcmp(format, "json") == 0) fmt = SCRIMPFF_METRICS_JSON;
+	else if (strcmp(format, "prometheus") == 0)
+		fmt = SCRIMPFF_METRICS_PROMETHEUS;
+	else
+	{
+		PyErr_SetString(PyExc_ValueError, "format must be \"json\" or "
+				"\"prometheus\"");
+		return NULL;
+	}
+
+	FILE * out = open_memstream(&text, &size);
+	if (out == NULL) return PyErr_NoMemory();
+	int err = scrimpff_metrics_write(self->ctx, out, fmt);
+	if (fclose(out) || err)
+	{
+		free(text);
+		return PyErr_NoMemory();
+	}
+
+	PyObject * report = PyUnicode_FromStringAndSize(text, size);
+	free(text);
+	return report;
+}
+
+static PyObject * Context_get_window(ContextObject * self, void * closure)
+{
+	return PyLong_FromLong(self->ctx ? self->ctx->windowSize : 0);
+}
+
+static PyObject * Context_get_profile_length(ContextObject * self,
+		void * closure)
+{
+	return PyLong_FromLong(self->series ? self->ctx->ProfileLength : 0);
+}
+
+static PyMethodDef Context_methods[] = {
+	{"load", (PyCFunction) Context_load, METH_VARARGS,
+		"load(series, window_size): use a float64 series, no copy; "
+		"the array is read-only until the next load"},
+	{"run", (PyCFunction) Context_run, METH_NOARGS,
+		"run() -> (profile, index): double precision SCRIMP"},
+	{"run_ff", (PyCFunction) Context_run_ff, METH_VARARGS | METH_KEYWORDS,
+		"run_ff(dist, dotp, stats, prof) -> (profile, index): "
+		"FlexFloat SCRIMP, formats given as (exp, man)"},
+	{"metrics", (PyCFunction) Context_metrics, METH_VARARGS,
+		"metrics(format=\"json\") -> str: phase timings and counters, "
+		"as JSON or Prometheus text"},
+	{NULL}
+};
+
+static PyGetSetDef Context_getset[] = {
+	{"window_size", (getter) Context_get_window, NULL, NULL, NULL},
+	{"profile_length", (getter) Context_get_profile_length, NULL, NULL,
+		NULL},
+	{NULL}
+};
+
+static PyTypeObject ContextType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name      = "scrimpff.Context",
+	.tp_doc       = "SCRIMP context: Context(num_threads=1)",
+	.tp_basicsize = sizeof(ContextObject),
+	.tp_flags     = Py_TPFLAGS_DEFAULT,
+	.tp_new       = PyType_GenericNew,
+	.tp_init      = (initproc) Context_init,
+	.tp_dealloc   = (destructor) Context_dealloc,
+	.tp_methods   = Context_methods,
+	.tp_getset    = Context_getset,
+};
+
+static struct PyModuleDef scrimpff_module = {
+	PyModuleDef_HEAD_INIT,
+	.m_name = "scrimpff",
+	.m_doc  = "SCRIMP FlexFloat matrix profile kernels",
+	.m_size = -1,
+};
+
+PyMODINIT_FUNC PyInit_scrimpff(void)
+{
+	import_array();
+
+	if (PyType_Ready(&ContextType) < 0) return NULL;
+
+	PyObject * module = PyModule_Create(&scrimpff_module);
+	if (module == NULL) return NULL;
+
+	Py_INCREF(&ContextType);
+	if (PyModule_AddObject(module, "Context", (PyObject *) &ContextType))
+	{
+		Py_DECREF(&ContextType);
+		Py_DECREF(module);
+		return NULL;
+	}
+	return module;
+}
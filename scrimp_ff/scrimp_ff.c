@@ -45,11 +45,15 @@ Details of Flexfloat library can be found at:
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 ********************************************************************************
 Usage: 
->> scrimpplusplus InputFile WindowSize nThreads Scale
+>> scrimpplusplus InputFile WindowSize nThreads Scale [MetricsFile]
 	- InputFile: Name of the time series file
 	- WindowSize: Subsequence length m
 	- nThreads: Number of threads to be spawn
 	- Scale: Scale factor for the time series data
+	- MetricsFile: Optional file for the phase timings and counters, in
+	  Prometheus text format if it ends in .prom and in JSON otherwise
+	  ("-" writes only the JSON to the standard output, and the progress
+	  messages to the standard error)
 
 Example input:
 >> scrimp_ff taxi.txt 100 8 1
@@ -62,388 +66,73 @@ The code will generate one output file (e.g. result_taxi.csv)
 	- Fourth column is the matrix profile distance value.
 	- Fifth column is the matrix profile index.
 	- Sixth column is the error
+	- When a .qcfg file exists, three more columns with the fixed point
+	  distance, index and error
 ############################################################################# */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include <sys/time.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <omp.h>
-#include "../flexfloat/include/flexfloat.h"
+#include "libscrimpff.h"
 
 #define PATH_TSERIES "./timeseries/"
 #define PATH_CFG "./configs/"
 #define PATH_RESULT "./results/result_"
-#define EXCLUSION_FACTOR 4
-
-unsigned dist_exp;
-unsigned dist_man;
-unsigned prof_exp;
-unsigned prof_man;
-unsigned dotp_exp;
-unsigned dotp_man;;
-unsigned stats_exp;
-unsigned stats_man;
-
-static struct timeval tm1;
-
-void scrimp(double * tSeries,  double * AMean, double * ASigma, 
-		int timeSeriesLength, int ProfileLength,
-		int windowSize, int* idx, double * profile, int * profileIndex,
-	       	int exclusionZone, int numThreads)
-{
-	/* Private structures initialization -------------------------------- */
-	double * profile_tmp   = malloc(sizeof(double) 
-			* ProfileLength * numThreads);
-	int * profileIndex_tmp = malloc(sizeof(int)    
-			* ProfileLength * numThreads);
-	for(int i = 0; i < ProfileLength * numThreads; i++)
-	{
-		profile_tmp[i]      = INFINITY;
-		profileIndex_tmp[i] = 0;
-	}
-	/* ------------------------------------------------------------------ */
-
-	#pragma omp parallel
-	{
-		double distance, windowSizeDTYPE, lastz;
-
-		int diag, my_offset, i, j, ri;
-
-		windowSizeDTYPE = (double) windowSize;
 
-		my_offset = omp_get_thread_num() * ProfileLength;
+static const char * native_names[] = {"", "float32", "float16", "bfloat16"};
 
-		#pragma omp for schedule(dynamic)
-		for (ri = 0; ri < (ProfileLength - (exclusionZone + 1)); ri++)
-		{
-			diag = idx[ri];
-			lastz = 0;
-
-			/* Dot product calculation -------------------------- */
-			for (j = diag; j < windowSize + diag; j++)
-			{
-				lastz += tSeries[j] * tSeries[j - diag];
-			}
-
-			j = diag;
-			i = 0;
-
-			/* Distance calculation ----------------------------- */
-			distance = 2 * (windowSizeDTYPE - (lastz - 
-				windowSizeDTYPE * AMean[j] * AMean[i]) / 
-				(ASigma[j] * ASigma[i]));
-
-			/* -------------------------------------------------- */
-			
-			/* Profile update ----------------------------------- */
-			if (distance < profile_tmp[my_offset + j])
-			{
-				profile_tmp[my_offset + j]     = distance;
-				profileIndex_tmp [my_offset+j] = i;
-			}
-			if (distance < profile_tmp[my_offset + i])
-			{
-				profile_tmp[my_offset + i]       = distance;
-				profileIndex_tmp [my_offset + i] = j;
-			}
-			/* -------------------------------------------------- */
-			i = 1;
-
-			for(j = diag + 1; j< ProfileLength; j++)
-			{
-				/* Dot product update ----------------------- */
-				lastz += (tSeries[j + windowSize - 1] * 
-					tSeries[i + windowSize - 1]) - 
-					(tSeries[j - 1] * tSeries[i - 1]);
-				/* ------------------------------------------ */
-
-				/* Distance calculation --------------------- */
-				distance =  2 * (windowSizeDTYPE - (lastz -  
-					AMean[j]  * AMean[i] * windowSizeDTYPE) 
-					/ (ASigma[j] * ASigma[i]));
-				/* ------------------------------------------ */
-
-				/* Profile update --------------------------- */
-				if (distance < profile_tmp[my_offset + j])
-				{
-					profile_tmp[my_offset + j] = distance;
-					profileIndex_tmp [my_offset+ j] = i;
-				}
-
-				if (distance < profile_tmp[my_offset + i])
-				{
-					profile_tmp[my_offset + i] = distance;
-					profileIndex_tmp[my_offset + i] = j;
-				}
-				/* ------------------------------------------ */
-				i++;
-			}
-
-		}
-
-		#pragma omp barrier
-		
-		/* Final profile reduction ---------------------------------- */ 
-		double min_distance;
-		int min_index;
-
-		#pragma omp for schedule(static)
-		for (int colum = 0; colum < ProfileLength; colum++)
-		{
-			min_distance = INFINITY;
-
-			min_index = 0;
-
-			for(int row = 0; row < numThreads; row++)
-			{
-				if(profile_tmp[colum + (row*ProfileLength)] 
-						< min_distance)
-				{
-					min_distance = profile_tmp[colum + 
-						(row * ProfileLength)];
-					min_index    = profileIndex_tmp[colum 
-						+ (row * ProfileLength)];
-				}
-			}
-			profile[colum]      = min_distance;
-			profileIndex[colum] = min_index;
-		}
-		#pragma omp barrier
-		/* ---------------------------------------------------------- */
-	}
-	free(profile_tmp);
-	free(profileIndex_tmp);
-}
-
-void scrimp_ff(flexfloat_t * tSeries, flexfloat_t* AMean, flexfloat_t* ASigma, 
-		int timeSeriesLength,int ProfileLength,	flexfloat_t windowSize, 
-		int* idx, flexfloat_t * profile, int* profileIdxs, 
-		int exclusionZone, int numThreads)
+static inline void done(uint64_t ns)
 {
-
-	int win = (int) ff_get_double(&windowSize);
-
-	/* Private structures initilization --------------------------------- */
-	flexfloat_t * profile_priv;
-	int         * profileIdxs_priv;
-	profile_priv    = malloc(sizeof(flexfloat_t) 
-			* timeSeriesLength * numThreads);
-	profileIdxs_priv = malloc(sizeof(int) 
-			* timeSeriesLength * numThreads);
-	for(int i = 0; i < timeSeriesLength * numThreads; i++)
-	{
-		ff_init_double(&profile_priv[i], INFINITY, 
-				(flexfloat_desc_t) {prof_exp, prof_man});
-		profileIdxs_priv[i] = 0;
-	}
+	/* Display the time of a phase -------------------------------------- */
+	printf("[INFO] DONE (elapsed time %.3f seconds)\n", ns * 1e-9);
 	/* ------------------------------------------------------------------ */
-
-	#pragma omp parallel
-	{
-		flexfloat_t substr;
-		flexfloat_t distance;
-		flexfloat_t sigma_prods;
-		flexfloat_t mean_prods;
-		flexfloat_t constant_2;
-		flexfloat_t lastz;
-		flexfloat_t lastz_cast;
-		flexfloat_t dist_cast;
-		flexfloat_t mean_cast;
-		flexfloat_t sigma_cast;
-		int myoffset = omp_get_thread_num() * timeSeriesLength;
-
-		ff_init_double(&substr, 0, 
-				(flexfloat_desc_t) {dotp_exp, dotp_man});
-		ff_init_double(&distance, 0, 
-				(flexfloat_desc_t) {dist_exp, dist_man});
-		ff_init_double(&mean_prods, 0, 
-				(flexfloat_desc_t) {stats_exp, stats_man});
-		ff_init_double(&sigma_prods, 0, 
-				(flexfloat_desc_t) {stats_exp, stats_man});
-		ff_init_double(&constant_2, 2.0, 
-				(flexfloat_desc_t) {dist_exp, dist_man});
-
-		#pragma omp for schedule(dynamic)
-		for (int ri = 0; ri < (ProfileLength - 
-					(exclusionZone + 1)); ri++)
-		{
-			int subseq = idx[ri];
-
-			/* Dot product calculation -------------------------- */
-			ff_init_double(&lastz,0, (flexfloat_desc_t) 
-					{dotp_exp, dotp_man});
-			for (int w = 0; w < win; w++)
-			{
-				ff_fma(&lastz,  &tSeries[w + subseq], 
-						&tSeries[w], &lastz);
-			}
-			ff_cast(&lastz_cast, &lastz, (flexfloat_desc_t) 
-					{dist_exp, dist_man});
-			/* -------------------------------------------------- */
-
-			/* Distance calculation ----------------------------- */
-                        ff_mul(&sigma_prods, &ASigma[subseq], &ASigma[0]);
-			ff_mul(&mean_prods, &AMean[subseq], &AMean [0]);
-			ff_cast(&mean_cast, &mean_prods, (flexfloat_desc_t)
-                                        {dist_exp, dist_man});
-                        ff_cast(&sigma_cast, &sigma_prods, (flexfloat_desc_t)
-					{dist_exp, dist_man});
-   			ff_mul(&distance,    &mean_cast,   &windowSize);
-                        ff_sub(&distance,    &lastz_cast, &distance);
-                        ff_div(&distance,    &distance,   &sigma_cast);
-                        ff_sub(&distance,    &windowSize, &distance);
-                        ff_mul(&distance,    &distance,   &constant_2);
-			/* -------------------------------------------------- */
-
-			/* Profile update ----------------------------------- */
-			ff_cast(&dist_cast, &distance, (flexfloat_desc_t)
-                                        {prof_exp, prof_man});
-			if (ff_lt(&dist_cast, &profile_priv[subseq + myoffset]))
-			{
-				profile_priv[subseq + myoffset]     = dist_cast;
-				profileIdxs_priv[subseq + myoffset] = 0;
-			}
-			if (ff_lt(&dist_cast, &profile_priv[myoffset]))
-			{
-				profile_priv[myoffset]     = dist_cast;
-				profileIdxs_priv[myoffset] = subseq;
-			}
-			/* -------------------------------------------------- */      
-			int i = 1;
-
-			for(int j = subseq + 1; j< ProfileLength; j++)
-			{
-				/* Dot product update ----------------------- */
-				ff_fma(&lastz,  &tSeries[j + win - 1], 
-						&tSeries[i + win - 1],  &lastz);
-				ff_mul(&substr, &tSeries[j - 1],        
-						&tSeries[ i - 1]);
-				ff_sub(&lastz,  &lastz, &substr);
-				ff_cast(&lastz_cast, &lastz, (flexfloat_desc_t)
-					       	{dist_exp, dist_man});
-				/* ------------------------------------------ */
-
-				/* Distance calculation --------------------- */
-				ff_mul(&sigma_prods, &ASigma[j],  &ASigma[i]);
-				ff_mul(&mean_prods,  &AMean[j],   &AMean [i]);
-                        	ff_cast(&mean_cast, &mean_prods, 
-					(flexfloat_desc_t){dist_exp, dist_man});
-                        	ff_cast(&sigma_cast, &sigma_prods, 
-					(flexfloat_desc_t){dist_exp, dist_man});
-				ff_mul(&distance,    &mean_cast,  &windowSize);
-				ff_sub(&distance,    &lastz_cast, &distance);
-				ff_div(&distance,    &distance,   &sigma_cast);
-				ff_sub(&distance,    &windowSize, &distance);
-				ff_mul(&distance,    &distance,   &constant_2);
-				/* ------------------------------------------ */
-
-				/* Profile update --------------------------- */
-				ff_cast(&dist_cast, &distance,(flexfloat_desc_t)
-                                        {prof_exp, prof_man});
-				if (ff_lt(&dist_cast,&profile_priv[j+myoffset]))
-				{
-					profile_priv[j + myoffset]  = dist_cast;
-					profileIdxs_priv[j+myoffset] = i;
-				}
-				if (ff_lt(&dist_cast,&profile_priv[i+myoffset]))
-				{
-					profile_priv[i + myoffset]  = dist_cast;
-					profileIdxs_priv[i+myoffset] = j;
-				}
-				/* ------------------------------------------ */
-				i++;
-			}
-
-		}
-		#pragma omp barrier
-
-		/* Final profile reduction ---------------------------------- */
-		flexfloat_t min_distance;
-		#pragma omp for schedule(static)
-		for (int colum = 0; colum < ProfileLength; colum++)
-		{
-			ff_init_double(&min_distance,  INFINITY, 
-				(flexfloat_desc_t) {prof_exp,prof_man});
-			int min_index = 0;
-
-			for(int row = 0; row < numThreads; row++)
-			{
-				if(ff_lt(&profile_priv[colum + 
-					(row*timeSeriesLength)], &min_distance))
-				{
-					min_distance = profile_priv[colum + 
-						(row *	timeSeriesLength)];
-					min_index    = profileIdxs_priv[colum +
-					       	(row * timeSeriesLength)];
-				}
-			}
-			profile[colum]     = min_distance;
-			profileIdxs[colum] = min_index;
-		}
-		#pragma omp barrier
-		/* ---------------------------------------------------------- */
-	}
-	free(profile_priv);
-	free(profileIdxs_priv);
 }
 
-static inline void start()
+static int write_metrics(const scrimpff_ctx_t * ctx, const char * path,
+		FILE * out)
 {
-	/* Starting chronograph --------------------------------------------- */
-	gettimeofday(&tm1, NULL);
+	/* Writes the metrics to path, .prom as Prometheus text, JSON else.
+	 * For "-" the JSON goes to out, the original standard output ------ */
+	if (strcmp(path, "-") == 0)
+		return (scrimpff_metrics_write(ctx, out, SCRIMPFF_METRICS_JSON)
+			|| fflush(out)) ? -1 : 0;
+
+	const char * dot = strrchr(path, '.');
+	scrimpff_metrics_format_t format = (dot && strcmp(dot, ".prom") == 0)
+		? SCRIMPFF_METRICS_PROMETHEUS : SCRIMPFF_METRICS_JSON;
+
+	FILE * file = fopen(path, "w");
+	if (file == NULL) return -1;
+	int err = scrimpff_metrics_write(ctx, file, format);
+	return (fclose(file) || err) ? -1 : 0;
 	/* ------------------------------------------------------------------ */
 }
 
-static inline void stop()
+static char * make_path(const char * prefix, const char * file_name,
+		const char * extension)
 {
-	/* Stop chronograph and display time -------------------------------- */
-	struct timeval tm2;
-	gettimeofday(&tm2, NULL);
-	unsigned long long t = 1000 * (tm2.tv_sec - tm1.tv_sec) + 
-		(tm2.tv_usec - tm1.tv_usec) / 1000;
-	double seconds = (double) t / 1000;
-	printf("[INFO] DONE (elapsed time %.3f seconds)\n", seconds);
+	/* Builds prefix + file_name with its extension replaced ------------ */
+	size_t base = strlen(file_name);
+	const char * dot = strrchr(file_name, '.');
+	if (extension != NULL && dot != NULL) base = dot - file_name;
+
+	size_t size = strlen(prefix) + base
+		+ (extension ? strlen(extension) : 0) + 1;
+	char * path = malloc(size);
+	if (path == NULL) return NULL;
+
+	snprintf(path, size, "%s%.*s%s", prefix, (int) base, file_name,
+			extension ? extension : "");
+	return path;
 	/* ------------------------------------------------------------------ */
 }
 
-void read_config(char * file_name)
-{
-	
-	char * path_config = malloc(1000 * sizeof(char));
-	
-        strcpy(path_config, PATH_CFG);
-        strcat(path_config, file_name);
-        path_config[strlen(path_config)-4] = 0;
-        strcat(path_config, ".cfg");
-
-        FILE * file = fopen (path_config, "r");
-	int err1, err2, err3, err4, err5, err6, err7, err8;
-	
-	if (file == NULL) printf("CFG FILE ERRROR\n");
-	err1 = fscanf(file, "%d", &dist_exp);
-	err2 = fscanf(file, "%d", &dist_man);
-  	err3 = fscanf(file, "%d", &dotp_exp);
-   	err4 = fscanf(file, "%d", &dotp_man);
-   	err5 = fscanf(file, "%d", &stats_exp);
-        err6 = fscanf(file, "%d", &stats_man);
-        err7 = fscanf(file, "%d", &prof_exp);
-        err8 = fscanf(file, "%d", &prof_man);
-	
-       if (!err1 || !err2 || !err3 || !err4 || !err5
-		      || !err6 || !err7 || !err8) 
-	       printf("CFG FILE ERRROR\n");
-
-	free(path_config);
-	fclose (file);
-}
-
-
-
 void print_header()
 {
 	/* Printing program header ------------------------------------------ */
@@ -464,196 +153,211 @@ void print_header()
 int main(int argc, char* argv[])
 {
 	FILE   * fp;
-	time_t t;
-	int    windowSize, ProfileLength, exclusionZone;
-	int    timeSeriesLength, numThreads;
-	double tSeriesMin, tSeriesMax;
-	double elapsed_time, scaleFactor;
-	double      * tSeries;
-	double      * AMean;
-	double      * ASigma;
-	double      * profile;
-	int         * profileIdxs;
-	int         * profileIdxs_ff;
-	int         * idx;
-	char        * path_tSeries;
-	char	    * path_result;
-	flexfloat_t * tSeries_ff;
-	flexfloat_t * AMean_ff;
-	flexfloat_t * ASigma_ff;
-	flexfloat_t * profile_ff;
+	int    windowSize, numThreads, timeSeriesLength;
+	double scaleFactor;
+	double         * tSeries;
+	char           * path_tSeries;
+	char           * path_config;
+	char           * path_qconfig;
+	char           * path_result;
+	scrimpff_ctx_t * ctx;
+	scrimpff_prec_t  prec;
+	scrimpff_fixed_t fx;
+	int              fixed;
+	FILE           * metrics_out = NULL;
+
+	/* With "-" as metrics file the standard output only gets the JSON:
+	 * it is kept in metrics_out and the progress goes to stderr */
+	if (argc == 6 && strcmp(argv[5], "-") == 0)
+	{
+		int fd = dup(STDOUT_FILENO);
+		if (fd >= 0) metrics_out = fdopen(fd, "w");
+		if (metrics_out == NULL
+			|| dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+		{
+			fprintf(stderr, "[ERROR] cannot redirect the standard"
+					" output\n");
+			return -1;
+		}
+	}
 
         ff_start_stats();
 	print_header();
 
 	/* Getting program arguments ---------------------------------------- */
-	if(argc !=5)
+	if(argc != 5 && argc != 6)
 	{
 		printf("[ERROR] usage: ./scrimp timeseries.txt window_size"
-				" num_threads scale_factor\n");
+				" num_threads scale_factor [metrics_file]\n");
 		return 0;
 	}
 	windowSize  = atoi(argv[2]);
 	numThreads  = atoi(argv[3]);
 	scaleFactor = atof(argv[4]);
-	omp_set_num_threads(numThreads);
-	read_config(argv[1]);
+
+	path_config  = make_path(PATH_CFG,     argv[1], ".cfg");
+	path_qconfig = make_path(PATH_CFG,     argv[1], ".qcfg");
+	path_tSeries = make_path(PATH_TSERIES, argv[1], NULL);
+	path_result  = make_path(PATH_RESULT,  argv[1], ".csv");
+
+	if (scrimpff_read_config(path_config, &prec))
+	{
+		printf("CFG FILE ERRROR\n");
+		return -1;
+	}
+
+	/* The fixed point kernel runs when a .qcfg file is present */
+	fp    = fopen(path_qconfig, "r");
+	fixed = (fp != NULL);
+	if (fp != NULL) fclose(fp);
+	if (fixed && scrimpff_read_fixed_config(path_qconfig, &fx))
+	{
+		printf("QCFG FILE ERRROR\n");
+		return -1;
+	}
+
+	ctx = scrimpff_ctx_create(numThreads);
+	if (ctx == NULL)
+	{
+		printf("[ERROR] invalid number of threads\n");
+		return -1;
+	}
 	/* ------------------------------------------------------------------ */
 
-	/* Time series loading and memory allocating ------------------------ */	
-	path_tSeries = malloc(1000 * sizeof(char));
-	strcpy(path_tSeries, PATH_TSERIES);
-	strcat(path_tSeries, argv[1]);
+	/* Time series loading ---------------------------------------------- */
 	printf("##############################################\n");
 	printf("[INFO] Loading %s ...\n", argv[1]);
-	timeSeriesLength = 0; 
+	timeSeriesLength = 0;
 	fp = fopen(path_tSeries, "r");
-	char c;
-	for (c = getc(fp); c != EOF; c = getc(fp)) 
-		if (c == '\n') 
+	if (fp == NULL)
+	{
+		printf("[ERROR] cannot open %s\n", path_tSeries);
+		return -1;
+	}
+	int c;
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_COUNT_LINES);
+	for (c = getc(fp); c != EOF; c = getc(fp))
+		if (c == '\n')
 			timeSeriesLength = timeSeriesLength + 1;
-	fclose(fp);
-
-	ProfileLength = timeSeriesLength - windowSize + 1;
-	exclusionZone = windowSize / EXCLUSION_FACTOR;
+	ctx->metrics.bytesRead += ftell(fp);
+	rewind(fp);
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_COUNT_LINES);
 
-	tSeries          = malloc(sizeof(double) * timeSeriesLength);
-	AMean            = malloc(sizeof(double) * ProfileLength);
-	ASigma           = malloc(sizeof(double) * ProfileLength);
-	profile          = malloc(sizeof(double) * ProfileLength);
-	profileIdxs      = malloc(sizeof(int)    * timeSeriesLength);
-	profileIdxs_ff   = malloc(sizeof(int)    * timeSeriesLength);
-	idx              = malloc(sizeof(int)    * timeSeriesLength);
-	tSeries_ff       = malloc(sizeof(flexfloat_t) * timeSeriesLength);
-	AMean_ff         = malloc(sizeof(flexfloat_t) * timeSeriesLength);
-	ASigma_ff        = malloc(sizeof(flexfloat_t) * timeSeriesLength);
-	profile_ff       = malloc(sizeof(flexfloat_t) * timeSeriesLength);
-
-	tSeriesMin = INFINITY;
-	tSeriesMax = 0;
+	tSeries = scrimpff_series(ctx, timeSeriesLength, windowSize);
+	if (tSeries == NULL)
+	{
+		printf("[ERROR] cannot allocate a %d elements time series\n",
+				timeSeriesLength);
+		return -1;
+	}
 
 	int err;
-	fp = fopen(path_tSeries, "r");
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_LOAD);
 	for(int i = 0; i < timeSeriesLength; i++)
 	{
 		err = fscanf(fp,"%lf",&tSeries[i]);
 		if(err < 0) return -1;
 		tSeries[i] *= scaleFactor;
-		if(tSeries[i] < tSeriesMin) tSeriesMin = tSeries[i];
-		if(tSeries[i] > tSeriesMax) tSeriesMax = tSeries[i];
-		ff_init_double(&tSeries_ff[i], tSeries[i],
-                                (flexfloat_desc_t) {dotp_exp, dotp_man});
 	}
+	ctx->metrics.bytesRead += ftell(fp);
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_LOAD);
 
 	fclose(fp);
 	printf("[INFO] DONE\n");
 	/* ------------------------------------------------------------------ */
 
+	/* Preprocessing statistics ----------------------------------------- */
+	printf("[INFO] Preprocessing statistics ...\n");
+	if (scrimpff_preprocess(ctx))
+	{
+		printf("[ERROR] window size larger than the time series\n");
+		return -1;
+	}
+	printf("[INFO] DONE\n");
+	/* ------------------------------------------------------------------ */
+
 	printf("[INFO] Program parameters:\n");
 	printf("----------------------------------------------\n");
 	printf("  Time series length: %d\n", timeSeriesLength);
 	printf("  Window size:        %d\n", windowSize);
-	printf("  Time series min:    %f\n", tSeriesMin);
-	printf("  Time series max:    %f\n", tSeriesMax);
-	printf("  Dot product max:    %f\n", pow(tSeriesMax,2) * windowSize);
+	printf("  Time series min:    %f\n", ctx->tSeriesMin);
+	printf("  Time series max:    %f\n", ctx->tSeriesMax);
+	printf("  Dot product max:    %f\n",
+			pow(ctx->tSeriesMax, 2) * windowSize);
 	printf("  Number of threads:  %d\n", numThreads);
         printf("  Scale factor:       %.4f\n", scaleFactor);
-        printf("  FF dist - exp, man: %d, %d\n", dist_exp, dist_man);
-	printf("  FF dotp - exp, man: %d, %d\n", dotp_exp, dotp_man);
-        printf("  FF stat - exp, man: %d, %d\n", stats_exp, stats_man);
-        printf("  FF prof - exp, man: %d, %d\n", prof_exp, prof_man);
-	printf("----------------------------------------------\n");
-
-	/* Preprocessing statistics ----------------------------------------- */
-	printf("[INFO] Preprocessing statistics ...\n");
-	double * ACumSum   = malloc(sizeof(double) * timeSeriesLength);
-	double * ASum      = malloc(sizeof(double) * timeSeriesLength);
-	double * ASumSq    = malloc(sizeof(double) * timeSeriesLength);
-	double * ASigmaSq  = malloc(sizeof(double) * timeSeriesLength);
-	double * ASqCumSum = malloc(sizeof(double) * timeSeriesLength);
-
-	ACumSum[0] = tSeries[0];
-	for (int i = 1; i < timeSeriesLength; i++)
-		ACumSum[i] = tSeries[i] + ACumSum[i - 1];  
-	ASqCumSum[0] = tSeries[0] * tSeries[0];
-	for (int i = 1; i < timeSeriesLength; i++)
-		ASqCumSum[i] = tSeries[i] * tSeries[i] + ASqCumSum[i - 1];
-	ASum[0] = ACumSum[windowSize - 1];
-	for (int i = 0; i < timeSeriesLength - windowSize; i++)
-		ASum[i + 1] = ACumSum[windowSize + i] - ACumSum[i];
-	ASumSq[0] = ASqCumSum[windowSize - 1];
-	for (int i = 0; i < timeSeriesLength - windowSize; i++)
-		ASumSq[i + 1] = ASqCumSum[windowSize + i] - ASqCumSum[i];
-	for (int i = 0; i < ProfileLength; i++)
-		AMean[i] = ASum[i] / windowSize;
-	for (int i = 0; i < ProfileLength; i++)
-		ASigmaSq[i] = ASumSq[i] / windowSize - AMean[i] * AMean[i];
-	for (int i = 0; i < ProfileLength; i++)
-		ASigma[i] = sqrt(ASigmaSq[i]);
-
-	free(ACumSum);
-	free(ASum);
-	free(ASqCumSum);
-	free(ASumSq);
-	free(ASigmaSq);
-
-	printf("[INFO] DONE\n");
-	/* ------------------------------------------------------------------ */
-
-	/* Initializing diagonals and flexfloat statistics------------------- */
-	for (int i = exclusionZone + 1; i < ProfileLength; i++)
+        printf("  FF dist - exp, man: %d, %d\n", prec.dist.exp_bits,
+			prec.dist.frac_bits);
+	printf("  FF dotp - exp, man: %d, %d\n", prec.dotp.exp_bits,
+			prec.dotp.frac_bits);
+        printf("  FF stat - exp, man: %d, %d\n", prec.stats.exp_bits,
+			prec.stats.frac_bits);
+        printf("  FF prof - exp, man: %d, %d\n", prec.prof.exp_bits,
+			prec.prof.frac_bits);
+	if (fixed)
 	{
-		idx[i - (exclusionZone + 1)] = i;
+		printf("  FX seri - Qm.n:     Q%d.%d\n", fx.series.m,
+				fx.series.n);
+		printf("  FX dotp - Qm.n:     Q%d.%d\n", fx.dotp.m, fx.dotp.n);
+		printf("  FX stat - Qm.n:     Q%d.%d\n", fx.stats.m, fx.stats.n);
+		printf("  FX dist - Qm.n:     Q%d.%d\n", fx.dist.m, fx.dist.n);
+		printf("  FX mode:            %s, %s\n",
+				fx.saturate ? "saturate" : "wrap",
+				fx.nearest  ? "nearest"  : "truncate");
 	}
-
-	for (int i = 0; i < ProfileLength; i++)
-	{
-		profile[i]     = INFINITY;
-		profileIdxs[i] = 0;
-	}
-
-	for(int i = 0; i < ProfileLength; i++)
-	{
-		ff_init_double(&AMean_ff[i],   AMean[i],   (flexfloat_desc_t) 
-				{stats_exp, stats_man});
-		ff_init_double(&ASigma_ff[i],  ASigma[i],  (flexfloat_desc_t) 
-				{stats_exp, stats_man});
-		ff_init_double(&profile_ff[i], profile[i], (flexfloat_desc_t) 
-				{prof_exp, prof_man});
-	}
-
-	flexfloat_t  windowSize_ff;
-	ff_init_double(&windowSize_ff, windowSize, (flexfloat_desc_t) 
-			{dist_exp, dist_man});
-	/* ------------------------------------------------------------------ */
+	printf("----------------------------------------------\n");
 
 	/* Running SCRIMP FF ------------------------------------------------ */
 	printf("[INFO] Running SCRIMP FlexFloat ...\n");
-	start();
-	scrimp_ff(tSeries_ff, AMean_ff, ASigma_ff, timeSeriesLength,
-			ProfileLength, windowSize_ff, idx,
-			profile_ff, profileIdxs_ff, exclusionZone, numThreads);
-	stop();
+	scrimpff_run_ff(ctx, &prec);
+	done(ctx->metrics.phaseLastNs[SCRIMPFF_PHASE_FF_CONVERT]
+		+ ctx->metrics.phaseLastNs[SCRIMPFF_PHASE_FF_KERNEL]);
 	/* ------------------------------------------------------------------ */
 
 	/* Running SCRIMP double precision ---------------------------------- */
 	printf("[INFO] Running SCRIMP  ...\n");
 
-	start();
-	scrimp(tSeries, AMean, ASigma, timeSeriesLength, ProfileLength,
-			windowSize, idx, profile, profileIdxs, exclusionZone,
-			numThreads);
-	stop();
+	scrimpff_run(ctx);
+	done(ctx->metrics.phaseLastNs[SCRIMPFF_PHASE_KERNEL]);
+	/* ------------------------------------------------------------------ */
+
+	/* Running SCRIMP native comparator -------------------------------- */
+	scrimpff_native_t native = scrimpff_native_format(&prec);
+	if (native != SCRIMPFF_NATIVE_NONE)
+	{
+		printf("[INFO] Running SCRIMP %s ...\n", native_names[native]);
+		scrimpff_run_native(ctx, native);
+		done(ctx->metrics.phaseLastNs[SCRIMPFF_PHASE_NATIVE]);
+	}
+	/* ------------------------------------------------------------------ */
+
+	/* Running SCRIMP fixed point --------------------------------------- */
+	if (fixed)
+	{
+		printf("[INFO] Running SCRIMP fixed point ...\n");
+		scrimpff_run_fixed(ctx, &fx);
+		done(ctx->metrics.phaseLastNs[SCRIMPFF_PHASE_FIXED]);
+	}
 	/* ------------------------------------------------------------------ */
 
 	/* Getting the results ---------------------------------------------- */
+	int           ProfileLength  = ctx->ProfileLength;
+	double      * profile        = ctx->profile;
+	int         * profileIdxs    = ctx->profileIdxs;
+	flexfloat_t * profile_ff     = ctx->profile_ff;
+	int         * profileIdxs_ff = ctx->profileIdxs_ff;
+
 	double minDistance_ff = INFINITY;
 	double maxDistance_ff = 0;
 	double minDistance    = INFINITY;
 	double maxDistance    = 0;
+	double minDistance_fx = INFINITY;
+	double maxDistance_fx = 0;
+	int minDistanceIdx_fx = 0, maxDistanceIdx_fx = 0;
 	int minDistanceIdx_ff, maxDistanceIdx_ff;
        	int minDistanceIdx,    maxDistanceIdx;
 
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_SCAN);
 	for(int i = 0; i < ProfileLength; i++)
 	{
 		if(ff_get_double(&profile_ff[i]) < minDistance_ff && 
@@ -680,7 +384,21 @@ int main(int argc, char* argv[])
 			maxDistance    = profile[i];
 			maxDistanceIdx = profileIdxs[i];
 		}
+
+		if(!fixed) continue;
+		double d_fx = ctx->profile_fixed[i];
+		if(d_fx < minDistance_fx && d_fx > 0)
+		{
+			minDistance_fx    = d_fx;
+			minDistanceIdx_fx = ctx->profileIdxs_fixed[i];
+		}
+		if(d_fx > maxDistance_fx && d_fx > 0)
+		{
+			maxDistance_fx    = d_fx;
+			maxDistanceIdx_fx = ctx->profileIdxs_fixed[i];
+		}
 	}
+	scrimpff_phase_end(ctx, SCRIMPFF_PHASE_SCAN);
 
 	minDistance_ff = sqrt(minDistance_ff);
 	maxDistance_ff = sqrt(maxDistance_ff);
@@ -694,7 +412,51 @@ int main(int argc, char* argv[])
 			maxDistanceIdx_ff);
 	printf(" SCRIMP    Min: %f Idx: %d\n", minDistance, minDistanceIdx);
 	printf(" SCRIMP    Max: %f Idx: %d\n", maxDistance, maxDistanceIdx);
+	if (fixed)
+	{
+		printf(" SCRIMP FX Min: %f Idx: %d\n", sqrt(minDistance_fx),
+				minDistanceIdx_fx);
+		printf(" SCRIMP FX Max: %f Idx: %d\n", sqrt(maxDistance_fx),
+				maxDistanceIdx_fx);
+	}
 	printf("----------------------------------------------\n");
+
+	if (native != SCRIMPFF_NATIVE_NONE)
+	{
+		/* Native kernel must reproduce the FlexFloat profile ------- */
+		double maxDiff = 0;
+		int    idxMatch = 0;
+		for (int i = 0; i < ProfileLength; i++)
+		{
+			double d_ff = ff_get_double(&profile_ff[i]);
+			double d_nat = ctx->profile_native[i];
+			double diff = (d_ff == d_nat) ? 0 : fabs(d_nat - d_ff);
+			if (diff > maxDiff || isnan(diff)) maxDiff = diff;
+			if (ctx->profileIdxs_native[i] == profileIdxs_ff[i])
+				idxMatch++;
+		}
+		printf("[INFO] %s vs FlexFloat:\n", native_names[native]);
+		printf("----------------------------------------------\n");
+		printf(" Max profile diff: %e\n", maxDiff);
+		printf(" Index matches:    %.2f%%\n",
+				100.0 * idxMatch / ProfileLength);
+		printf("----------------------------------------------\n");
+		/* ---------------------------------------------------------- */
+	}
+	if (fixed)
+	{
+		printf("[INFO] Fixed point overflows:\n");
+		printf("----------------------------------------------\n");
+		printf("  Series:      %llu\n",
+			ctx->fixedOverflows[SCRIMPFF_FX_SERIES]);
+		printf("  Dot product: %llu\n",
+			ctx->fixedOverflows[SCRIMPFF_FX_DOTP]);
+		printf("  Statistics:  %llu\n",
+			ctx->fixedOverflows[SCRIMPFF_FX_STATS]);
+		printf("  Distance:    %llu\n",
+			ctx->fixedOverflows[SCRIMPFF_FX_DIST]);
+		printf("----------------------------------------------\n");
+	}
 	printf("[INFO] FlexFloat stats:\n");
 	printf("----------------------------------------------\n");
 	ff_print_stats();
@@ -702,47 +464,58 @@ int main(int argc, char* argv[])
 	/* ------------------------------------------------------------------ */
 
 	/* Saving results to file ------------------------------------------- */
-	path_result = malloc(1000 * sizeof(char));
-	strcpy(path_result, "result_");
-	strcat(path_result, argv[1]);
-	path_result[strlen(path_result)-4] = 0;
-	strcat(path_result, ".csv");
-	printf("[INFO] Saving %s ...\n", path_result);
-
-	strcpy(path_result, PATH_RESULT);
-	strcat(path_result, argv[1]);
-	path_result[strlen(path_result)-4] = 0;
-	strcat(path_result, ".csv"); 
+	printf("[INFO] Saving %s ...\n", strrchr(path_result, '/') + 1);
 
+	scrimpff_phase_begin(ctx, SCRIMPFF_PHASE_WRITE);
 	fp = fopen(path_result,"w");
+	if (fp == NULL)
+	{
+		printf("[ERROR] cannot write %s\n", path_result);
+		return -1;
+	}
 	double error;
 	for (int i = 0; i < ProfileLength; i++) {
 		error = (fabs((sqrt(profile[i])
                                 - sqrt(ff_get_double(&profile_ff[i]))))
                                 / sqrt(profile[i])) * 100;
-		fprintf(fp, "%d,%f,%f,%d,%f,%d,%f\n", i, tSeries[i], 
+		fprintf(fp, "%d,%f,%f,%d,%f,%d,%f", i, tSeries[i], 
 				sqrt(ff_get_double(&profile_ff[i])), 
 				profileIdxs_ff[i], sqrt(profile[i]),
 				profileIdxs[i], error);
+		if (fixed)
+		{
+			error = (fabs(sqrt(profile[i])
+				- sqrt(ctx->profile_fixed[i]))
+				/ sqrt(profile[i])) * 100;
+			fprintf(fp, ",%f,%d,%f", sqrt(ctx->profile_fixed[i]),
+					ctx->profileIdxs_fixed[i], error);
+		}
+		fprintf(fp, "\n");
 	}
+	ctx->metrics.bytesWritten += ftell(fp);
 	fclose(fp);
+	done(scrimpff_phase_end(ctx, SCRIMPFF_PHASE_WRITE));
+	/* ------------------------------------------------------------------ */
 
-	printf("[INFO] DONE\n");
+	/* Saving metrics --------------------------------------------------- */
+	if (argc == 6)
+	{
+		if (strcmp(argv[5], "-") != 0)
+			printf("[INFO] Saving %s ...\n", argv[5]);
+		if (write_metrics(ctx, argv[5], metrics_out))
+		{
+			printf("[ERROR] cannot write %s\n", argv[5]);
+			return -1;
+		}
+	}
 	/* ------------------------------------------------------------------ */
 
+	free(path_config);
+	free(path_qconfig);
 	free(path_tSeries);
 	free(path_result);
-	free(tSeries);
-	free(AMean); 
-	free(ASigma);
-	free(profile);
-	free(profileIdxs);
-	free(profileIdxs_ff);
-	free(idx);
-	free(tSeries_ff);
-	free(AMean_ff);
-	free(ASigma_ff);
-	free(profile_ff);
+	scrimpff_ctx_destroy(ctx);
+	if (metrics_out != NULL) fclose(metrics_out);
 
 	printf("##############################################\n");
 
@@ -0,0 +1,235 @@
+/* #############################################################################
+SCRIMP kernel template for formats with a hardware (or cheap to convert)
+representation. It is included by libscrimpff.c once per format with:
+
+	NATIVE_NAME          kernel function name
+	NATIVE_STORAGE_T     type the series, statistics and profiles are stored in
+	NATIVE_COMPUTE_T     type the arithmetic is done in
+	NATIVE_LOAD(x)       NATIVE_STORAGE_T -> NATIVE_COMPUTE_T
+	NATIVE_STORE(x)      NATIVE_COMPUTE_T -> NATIVE_STORAGE_T (rounding)
+	NATIVE_STORE_WIDE(x) double -> NATIVE_STORAGE_T, rounding only once
+	NATIVE_FMA           fused multiply-add in double, as FlexFloat computes it
+
+Every operation is rounded back to the storage format, following the same
+sequence of operations as scrimp_ff(), so the results match a FlexFloat run
+whose four stages use the (exp, man) of the storage format. This only holds
+if the compiler does not contract a multiply and an add into an FMA, so the
+library is built with -ffp-contract=off.
+
+Each thread takes NATIVE_LANES consecutive diagonals at a time and updates
+their dot products in lockstep, so the dependency chains of the lanes overlap
+instead of waiting on each other, and keeps them in lastzs32. Then each
+diagonal, in the original order, is processed in blocks: the distances and the
+profile updates run in branch-free loops the compiler can vectorize. Ties are
+therefore resolved as in scrimp_ff().
+############################################################################# */
+
+#define NATIVE_ROUND(x)      NATIVE_LOAD(NATIVE_STORE(x))
+#define NATIVE_ROUND_WIDE(x) NATIVE_LOAD(NATIVE_STORE_WIDE(x))
+
+static void NATIVE_NAME(scrimpff_ctx_t * ctx, scrimpff_thread_metrics_t tm)
+{
+	int timeSeriesLength = ctx->timeSeriesLength;
+	int ProfileLength    = ctx->ProfileLength;
+	int exclusionZone    = ctx->exclusionZone;
+	int numThreads       = ctx->numThreads;
+	int win              = ctx->windowSize;
+	scrimpff_scratch_t * s = ctx->scratch;
+	int * idx            = s->idx;
+
+	NATIVE_STORAGE_T * tSeries      = (NATIVE_STORAGE_T *) s->tSeries32;
+	NATIVE_STORAGE_T * AMean        = (NATIVE_STORAGE_T *) s->AMean32;
+	NATIVE_STORAGE_T * ASigma       = (NATIVE_STORAGE_T *) s->ASigma32;
+	NATIVE_STORAGE_T * profile_priv = (NATIVE_STORAGE_T *)
+		s->profile_priv32;
+	int * profileIdxs_priv          = s->profileIdxs_priv;
+
+	/* Converting inputs to the storage format -------------------------- */
+	for (int i = 0; i < timeSeriesLength; i++)
+		tSeries[i] = NATIVE_STORE_WIDE(ctx->tSeries[i]);
+	for (int i = 0; i < ProfileLength; i++)
+	{
+		AMean[i]  = NATIVE_STORE_WIDE(ctx->AMean[i]);
+		ASigma[i] = NATIVE_STORE_WIDE(ctx->ASigma[i]);
+	}
+	for (int i = 0; i < ProfileLength * numThreads; i++)
+	{
+		profile_priv[i]     = NATIVE_STORE_WIDE(INFINITY);
+		profileIdxs_priv[i] = 0;
+	}
+	/* ------------------------------------------------------------------ */
+
+	int numDiagonals = ProfileLength - (exclusionZone + 1);
+
+	#pragma omp parallel num_threads(numThreads)
+	{
+		NATIVE_COMPUTE_T windowSize = NATIVE_ROUND_WIDE(win);
+		NATIVE_COMPUTE_T distances[NATIVE_BLOCK];
+		NATIVE_COMPUTE_T lastz[NATIVE_LANES];
+		int subseqs[NATIVE_LANES];
+		int tid      = omp_get_thread_num();
+		int myoffset = tid * ProfileLength;
+		NATIVE_COMPUTE_T * lastzs = (NATIVE_COMPUTE_T *) s->lastzs32
+			+ (size_t) myoffset * NATIVE_LANES;
+		uint64_t diagonals = 0;
+		uint64_t t0 = scrimpff_now_ns();
+
+		#pragma omp for schedule(dynamic) nowait
+		for (int ri = 0; ri < numDiagonals; ri += NATIVE_LANES)
+		{
+			int lanes = numDiagonals - ri;
+			if (lanes > NATIVE_LANES) lanes = NATIVE_LANES;
+
+			/* Dot products of the lanes ------------------------ */
+			for (int g = 0; g < lanes; g++)
+			{
+				subseqs[g] = idx[ri + g];
+				lastz[g] = 0;
+				for (int w = 0; w < win; w++)
+					lastz[g] = NATIVE_ROUND_WIDE(NATIVE_FMA(
+						NATIVE_LOAD(tSeries[w + subseqs[g]]),
+						NATIVE_LOAD(tSeries[w]), lastz[g]));
+				lastzs[g] = lastz[g];
+			}
+
+			/* While every lane is in range, on consecutive diagonals the
+			 * loads of the lanes are contiguous and the lanes vectorize */
+			int i = 1;
+			if (lanes == NATIVE_LANES
+				&& subseqs[NATIVE_LANES - 1] == subseqs[0] + NATIVE_LANES - 1)
+			{
+				int shortest = ProfileLength - subseqs[NATIVE_LANES - 1];
+				for (; i < shortest; i++)
+				{
+					const NATIVE_STORAGE_T * tj = tSeries + subseqs[0] + i;
+					NATIVE_COMPUTE_T ti_new = NATIVE_LOAD(tSeries[i + win - 1]);
+					NATIVE_COMPUTE_T ti_old = NATIVE_LOAD(tSeries[i - 1]);
+					/* Kept as a loop so it is vectorized, not unrolled */
+					#pragma GCC unroll 1
+					for (int g = 0; g < NATIVE_LANES; g++)
+					{
+						NATIVE_COMPUTE_T z = NATIVE_ROUND_WIDE(NATIVE_FMA(
+							NATIVE_LOAD(tj[g + win - 1]), ti_new, lastz[g]));
+						lastz[g] = NATIVE_ROUND(z - NATIVE_ROUND(
+							NATIVE_LOAD(tj[g - 1]) * ti_old));
+						lastzs[i * NATIVE_LANES + g] = lastz[g];
+					}
+				}
+			}
+
+			/* Then each lane up to the end of its diagonal */
+			for (int g = 0; g < lanes; g++)
+				for (int k = i; k < ProfileLength - subseqs[g]; k++)
+				{
+					int j = subseqs[g] + k;
+					NATIVE_COMPUTE_T z = NATIVE_ROUND_WIDE(NATIVE_FMA(
+						NATIVE_LOAD(tSeries[j + win - 1]),
+						NATIVE_LOAD(tSeries[k + win - 1]),
+						lastz[g]));
+					lastz[g] = NATIVE_ROUND(z - NATIVE_ROUND(
+						NATIVE_LOAD(tSeries[j - 1]) *
+						NATIVE_LOAD(tSeries[k - 1])));
+					lastzs[k * NATIVE_LANES + g] = lastz[g];
+				}
+			/* -------------------------------------------------- */
+
+			for (int g = 0; g < lanes; g++)
+			{
+				int subseq = subseqs[g];
+				diagonals++;
+
+				for (int base = subseq; base < ProfileLength;
+						base += NATIVE_BLOCK)
+				{
+					int len = ProfileLength - base;
+					if (len > NATIVE_BLOCK) len = NATIVE_BLOCK;
+					int b = base - subseq;
+
+					/* Distances of the block ----------- */
+					for (int k = 0; k < len; k++)
+					{
+						NATIVE_COMPUTE_T sigma_prods = NATIVE_ROUND(
+							NATIVE_LOAD(ASigma[base + k])
+							* NATIVE_LOAD(ASigma[b + k]));
+						NATIVE_COMPUTE_T mean_prods  = NATIVE_ROUND(
+							NATIVE_LOAD(AMean[base + k])
+							* NATIVE_LOAD(AMean[b + k]));
+						NATIVE_COMPUTE_T distance;
+						distance = NATIVE_ROUND(mean_prods * windowSize);
+						distance = NATIVE_ROUND(
+							lastzs[(b + k) * NATIVE_LANES + g] - distance);
+						distance = NATIVE_ROUND(distance / sigma_prods);
+						distance = NATIVE_ROUND(windowSize - distance);
+						distances[k] = NATIVE_ROUND(distance * 2);
+					}
+					/* ---------------------------------- */
+
+					/* Profile updates, j then i -------- */
+					NATIVE_STORAGE_T * prof_j = profile_priv + myoffset
+						+ base;
+					int * idxs_j = profileIdxs_priv + myoffset + base;
+					for (int k = 0; k < len; k++)
+					{
+						int better = distances[k]
+							< NATIVE_LOAD(prof_j[k]);
+						prof_j[k] = better
+							? NATIVE_STORE(distances[k]) : prof_j[k];
+						idxs_j[k] = better ? b + k : idxs_j[k];
+					}
+
+					NATIVE_STORAGE_T * prof_i = prof_j - subseq;
+					int * idxs_i = idxs_j - subseq;
+					for (int k = 0; k < len; k++)
+					{
+						int better = distances[k]
+							< NATIVE_LOAD(prof_i[k]);
+						prof_i[k] = better
+							? NATIVE_STORE(distances[k]) : prof_i[k];
+						idxs_i[k] = better ? base + k : idxs_i[k];
+					}
+					/* ---------------------------------- */
+				}
+			}
+		}
+		uint64_t t1 = scrimpff_now_ns();
+		#pragma omp barrier
+
+		/* Final profile reduction ---------------------------------- */
+		uint64_t t2 = scrimpff_now_ns();
+		#pragma omp for schedule(static) nowait
+		for (int colum = 0; colum < ProfileLength; colum++)
+		{
+			NATIVE_COMPUTE_T min_distance = INFINITY;
+			int min_index = 0;
+
+			for (int row = 0; row < numThreads; row++)
+			{
+				NATIVE_COMPUTE_T d = NATIVE_LOAD(profile_priv[colum
+						+ (row * ProfileLength)]);
+				if (d < min_distance)
+				{
+					min_distance = d;
+					min_index    = profileIdxs_priv[colum
+						+ (row * ProfileLength)];
+				}
+			}
+			ctx->profile_native[colum]     = min_distance;
+			ctx->profileIdxs_native[colum] = min_index;
+		}
+		/* ---------------------------------------------------------- */
+
+		if (tm.diagNs)    tm.diagNs[tid]    = t1 - t0;
+		if (tm.reduceNs)  tm.reduceNs[tid]  = scrimpff_now_ns() - t2;
+		if (tm.diagonals) tm.diagonals[tid] = diagonals;
+	}
+}
+
+#undef NATIVE_ROUND
+#undef NATIVE_ROUND_WIDE
+#undef NATIVE_NAME
+#undef NATIVE_STORAGE_T
+#undef NATIVE_COMPUTE_T
+#undef NATIVE_LOAD
+#undef NATIVE_STORE
+#undef NATIVE_STORE_WIDE
+#undef NATIVE_FMA
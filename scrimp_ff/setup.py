@@ -0,0 +1,24 @@
+# Builds the scrimpff Python module: python setup.py build_ext --inplace
+# The target defaults to the building machine, SCRIMPFF_ARCH overrides it.
+import os
+from setuptools import setup, Extension
+import numpy
+
+arch = os.environ.get('SCRIMPFF_ARCH', '-march=native').split()
+
+setup(
+    name='scrimpff',
+    ext_modules=[
+        Extension(
+            'scrimpff',
+            sources=['pyscrimpff.c', 'libscrimpff.c'],
+            include_dirs=[numpy.get_include()],
+            define_macros=[('NPY_NO_DEPRECATED_API', 'NPY_1_7_API_VERSION')],
+            library_dirs=['../flexfloat/build'],
+            libraries=['flexfloat', 'm'],
+            extra_compile_args=['-O3'] + arch + ['-ffp-contract=off',
+                                                  '-fopenmp'],
+            extra_link_args=['-fopenmp'],
+        )
+    ],
+)